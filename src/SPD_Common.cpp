@@ -115,5 +115,15 @@ SPD_API const char * SPD_GetLibVersion()
 	return SPD_LIB_VERSION;
 }
 
+int StringSource::Read( char * buf, size_t size )
+{
+	size_t len = m_str.size() - m_pos;
+	if( len > size )
+		len = size;
+	memcpy( buf, m_str.data() + m_pos, len );
+	m_pos += len;
+	return (int)len;
+}
+
 ////////////////////////////////
 END_NS_SPD
@@ -29,6 +29,9 @@
 
 #define SPD_LIB_VERSION "0.5.5"
 
+#include <stddef.h>
+#include <string>
+
 #define BEGIN_NS_SPD namespace spd {
 #define END_NS_SPD }
 
@@ -49,6 +52,8 @@ enum SPD_Error_t
 	SPD_ERR_BAD_PARAM,			// user provide function param invalid, such as col num < 0
 	SPD_ERR_FORBID_DEL_TCELL,	// when delete child, TCell can not be deleted.
 	SPD_ERR_BAD_MERGE_STATE,	// when modify vmerge or rowspan, the state is not correct
+	SPD_ERR_OPEN_INDEX,			// index segment missing or corrupted
+	SPD_ERR_SAVE_INDEX,
 
 	SPD_ERR_END
 };
@@ -86,6 +91,43 @@ SPD_API int SPD_SetLogLevel( int level );
 
 SPD_API const char * SPD_GetLibVersion();
 
+// <3> Text IO
+
+// output of streaming export, Write() return < 0 means error and stop
+class SPD_API TextSink
+{
+public:
+	virtual ~TextSink() { }
+	virtual int Write( const char * data, size_t len ) = 0;
+};
+
+// input of streaming import, Read() return read len, 0 means end, < 0 means error
+class SPD_API TextSource
+{
+public:
+	virtual ~TextSource() { }
+	virtual int Read( char * buf, size_t size ) = 0;
+};
+
+class SPD_API StringSink : public TextSink
+{
+public:
+	explicit StringSink( std::string & str ) : m_str( str ) { }
+	int Write( const char * data, size_t len ) override { m_str.append( data, len ); return (int)len; }
+private:
+	std::string & m_str;
+};
+
+class SPD_API StringSource : public TextSource
+{
+public:
+	explicit StringSource( const std::string & str ) : m_str( str ) { }
+	int Read( char * buf, size_t size ) override;
+private:
+	const std::string & m_str;
+	size_t m_pos = 0;
+};
+
 ////////////////////////////////
 END_NS_SPD
 
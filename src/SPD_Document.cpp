@@ -18,12 +18,40 @@
 #include "SPD_NewDocData.h"
 
 #include <zip.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <stdlib.h> // strtoul
 #include <string.h> // strcmp
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
 BEGIN_NS_SPD
 ////////////////////////////////
 
+// Element only has xml node, find the owner Document by xml root node
+static std::mutex s_docMutex;
+static std::map< const pugi::xml_node_struct *, Document * > s_docMap;
+// changed by every register / unregister, per thread last lookup is valid while not changed
+static std::atomic<uint32_t> s_docGen( 0 );
+
 Document::Document()
 {
 	 
@@ -134,6 +162,79 @@ int Document::write_zip( const std::string & fname, const std::map< std::string,
 	return SPD_ERR_OK;
 }
 
+int Document::copy_file( const std::string & src, const std::string & dst )
+{
+#ifdef _WIN32
+	if( !::CopyFileA( src.c_str(), dst.c_str(), FALSE ) ) {
+		SPD_PR_INFO( "CopyFile() [%s] to [%s] failed, err %d", src.c_str(), dst.c_str(), (int)::GetLastError() );
+		return SPD_ERR_SAVE_ZIP;
+	}
+	return SPD_ERR_OK;
+#else
+	int infd = open( src.c_str(), O_RDONLY | O_CLOEXEC );
+	if( infd < 0 ) {
+		SPD_PR_INFO( "open() [%s] failed, err %d", src.c_str(), errno );
+		return SPD_ERR_SAVE_ZIP;
+	}
+	struct stat inst;
+	if( fstat( infd, &inst ) != 0 ) {
+		close( infd );
+		return SPD_ERR_SAVE_ZIP;
+	}
+	// not truncate before check, dst maybe the same file with other path
+	int outfd = open( dst.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644 );
+	if( outfd < 0 ) {
+		SPD_PR_INFO( "open() [%s] failed, err %d", dst.c_str(), errno );
+		close( infd );
+		return SPD_ERR_SAVE_ZIP;
+	}
+	struct stat outst;
+	if( fstat( outfd, &outst ) == 0 && outst.st_dev == inst.st_dev && outst.st_ino == inst.st_ino ) {
+		close( infd );
+		close( outfd );
+		return SPD_ERR_OK;
+	}
+	if( ftruncate( outfd, 0 ) != 0 ) {
+		close( infd );
+		close( outfd );
+		return SPD_ERR_SAVE_ZIP;
+	}
+
+	off_t left = inst.st_size;
+#ifdef __linux__
+	// copy in kernel, copy_file_range() may fail cross filesystem, then try sendfile()
+	while( left > 0 ) {
+		ssize_t len = copy_file_range( infd, nullptr, outfd, nullptr, (size_t)left, 0 );
+		if( len <= 0 )
+			break;
+		left -= len;
+	}
+	while( left > 0 ) {
+		ssize_t len = sendfile( outfd, infd, nullptr, (size_t)left );
+		if( len <= 0 )
+			break;
+		left -= len;
+	}
+#endif
+	// fallback, file offset is right after partial copy
+	char buf[64 * 1024];
+	while( left > 0 ) {
+		ssize_t len = read( infd, buf, sizeof( buf ) );
+		if( len <= 0 )
+			break;
+		if( write( outfd, buf, (size_t)len ) != len )
+			break;
+		left -= len;
+	}
+	close( infd );
+	if( close( outfd ) != 0 || left != 0 ) {
+		SPD_PR_INFO( "copy [%s] to [%s] failed, left %d", src.c_str(), dst.c_str(), (int)left );
+		return SPD_ERR_SAVE_ZIP;
+	}
+	return SPD_ERR_OK;
+#endif // _WIN32
+}
+
 int Document::Open( const std::string & fname )
 {
 	Close();
@@ -147,6 +248,7 @@ int Document::Open( const std::string & fname )
 		return ret;
 	}
 	m_fname = fname;
+	m_srcName = fname;
 	return SPD_ERR_OK;
 }
 
@@ -164,6 +266,8 @@ int Document::parse_files()
 		SPD_PR_INFO( "bad xml content" );
 		return SPD_ERR_OPEN_XML;
 	}
+	register_doc();
+	load_body_range();  // ignore error, just save whole xml
 
 	if (load_style() < 0) {
 		SPD_PR_INFO("bad style content");
@@ -201,6 +305,100 @@ int Document::write_xml( const std::string & fname, const pugi::xml_document & d
 	return SPD_ERR_OK;
 }
 
+int Document::load_body_range()
+{
+	m_bodyRange.clear();
+	m_bodyHead = m_bodyTail = 0;
+
+	auto it = m_files.find( "word/document.xml" );
+	if( it == m_files.end() || it->second.size() < 2 )
+		return SPD_ERR_ERROR;
+	const std::vector<char> & fbuf = it->second;
+	size_t fsize = fbuf.size() - 1;  // extra '\0'
+	pugi::xml_node body = m_doc.document_element().first_child();
+	if( body.first_child().empty() )
+		return SPD_ERR_ERROR;
+
+	// offset_debug() is offset of element name in parse buffer, the buffer is same as file if UTF-8
+	size_t prev_begin = 0;
+	pugi::xml_node prev;
+	for( pugi::xml_node nd = body.first_child(); !nd.empty(); nd = nd.next_sibling() ) {
+		ptrdiff_t off = nd.offset_debug();
+		size_t namelen = strlen( nd.name() );
+		if( nd.type() != pugi::node_element || off <= 0 || (size_t)off + namelen > fsize
+			|| fbuf[off - 1] != '<' || memcmp( &fbuf[off], nd.name(), namelen ) != 0
+			|| (size_t)off - 1 < prev_begin ) 
+		{
+			SPD_PR_DEBUG( "body child offset not match, disable range" );
+			m_bodyRange.clear();
+			m_bodyHead = 0;
+			return SPD_ERR_ERROR;
+		}
+		if( prev.empty() ) {
+			m_bodyHead = (size_t)off - 1;
+		}
+		else {
+			m_bodyRange[prev.internal_object()] = std::make_pair( prev_begin, (size_t)off - 1 );
+		}
+		prev = nd;
+		prev_begin = (size_t)off - 1;
+	}
+
+	// last child end at "</w:body>"
+	static const char s_tail[] = "</w:body>";
+	size_t taillen = sizeof( s_tail ) - 1;
+	size_t pos = fsize;
+	while( pos >= prev_begin + taillen && memcmp( &fbuf[pos - taillen], s_tail, taillen ) != 0 )
+		--pos;
+	if( pos < prev_begin + taillen ) {
+		SPD_PR_DEBUG( "body end tag not found, disable range" );
+		m_bodyRange.clear();
+		m_bodyHead = 0;
+		return SPD_ERR_ERROR;
+	}
+	m_bodyTail = pos - taillen;
+	m_bodyRange[prev.internal_object()] = std::make_pair( prev_begin, m_bodyTail );
+	return SPD_ERR_OK;
+}
+
+int Document::write_body_range()
+{
+	auto it = m_files.find( "word/document.xml" );
+	if( m_bodyHead == 0 || it == m_files.end() )
+		return SPD_ERR_ERROR;
+	const std::vector<char> & fbuf = it->second;
+	size_t fsize = fbuf.size() - 1;  // extra '\0'
+
+	std::vector<char> nbuf;
+	BufferWriter writer( nbuf );
+	nbuf.reserve( fbuf.size() + 4096 );
+	std::map< const pugi::xml_node_struct *, std::pair< size_t, size_t > > nrange;
+
+	// head and tail is not modifiable, untouched child copy original bytes, others serialize again
+	nbuf.insert( nbuf.end(), fbuf.begin(), fbuf.begin() + m_bodyHead );
+	pugi::xml_node body = m_doc.document_element().first_child();
+	for( pugi::xml_node nd = body.first_child(); !nd.empty(); nd = nd.next_sibling() ) {
+		size_t begin = nbuf.size();
+		auto rit = m_bodyRange.find( nd.internal_object() );
+		if( rit != m_bodyRange.end() ) {
+			nbuf.insert( nbuf.end(), fbuf.begin() + rit->second.first, fbuf.begin() + rit->second.second );
+		}
+		else {
+			nd.print( writer, "", pugi::format_raw );
+		}
+		nrange[nd.internal_object()] = std::make_pair( begin, nbuf.size() );
+	}
+	size_t ntail = nbuf.size();
+	nbuf.insert( nbuf.end(), fbuf.begin() + m_bodyTail, fbuf.begin() + fsize );
+	nbuf.push_back( '\0' );
+
+	// new buffer is same as document now, all child is untouched
+	it->second.swap( nbuf );
+	m_bodyRange.swap( nrange );
+	m_bodyTail = ntail;
+	return SPD_ERR_OK;
+}
+
 int Document::Save( const std::string & fname )
 {
 	int ret = SPD_ERR_ERROR;
@@ -212,7 +410,22 @@ int Document::Save( const std::string & fname )
 		return SPD_ERR_SAVE_ZIP;
 	}
 
-	write_xml( "word/document.xml", m_doc );
+	// nothing changed, no need to rebuild zip
+	if( !m_isModified && !m_srcName.empty() ) {
+		if( m_srcName == m_fname )
+			return SPD_ERR_OK;
+		if( copy_file( m_srcName, m_fname ) == SPD_ERR_OK ) {
+			m_srcName = m_fname;
+			return SPD_ERR_OK;
+		}
+		// copy failed, source maybe removed, rebuild it
+	}
+
+	if( write_body_range() != SPD_ERR_OK ) {
+		write_xml( "word/document.xml", m_doc );
+		m_bodyRange.clear();
+		m_bodyHead = m_bodyTail = 0;
+	}
 	
 	write_style();
 	write_rela();
@@ -221,21 +434,103 @@ int Document::Save( const std::string & fname )
 	if( ( ret = write_zip( m_fname, m_files ) ) != SPD_ERR_OK ) {
 		return ret;
 	}
+	m_srcName = m_fname;
+	m_isModified = false;
 	return SPD_ERR_OK;
 }
 
 int Document::Close()
 {
+	unregister_doc();
 	m_fname.clear();
+	m_srcName.clear();
 	m_files.clear();
 	m_isModified = false;
 
 	m_doc.reset();
+	m_bodyRange.clear();
+	m_bodyHead = m_bodyTail = 0;
+	m_elemIndex.clear();
+	m_elemIndexValid = false;
+	m_elemIndexEdit = 0;
+	m_idNode.clear();
+	m_nodeId.clear();
+	m_idSeq = 0;
+	m_idIndexValid = false;
+	m_tableGrid.clear();
 	m_style.clear();
+	m_styleName.clear();
+	m_styleNameNoCase.clear();
+	m_styleNameCount.clear();
+	m_docDefault = ParaFormat();
+	m_defaultParaStyle = nullptr;
+	m_styleFormat.clear();
 	m_rela.clear();
 	return SPD_ERR_OK;
 }
 
+void Document::register_doc()
+{
+	std::lock_guard<std::mutex> guard( s_docMutex );
+	s_docMap[m_doc.internal_object()] = this;
+	s_docGen.fetch_add( 1, std::memory_order_release );
+}
+
+void Document::unregister_doc()
+{
+	std::lock_guard<std::mutex> guard( s_docMutex );
+	auto it = s_docMap.find( m_doc.internal_object() );
+	if( it != s_docMap.end() && it->second == this )
+		s_docMap.erase( it );
+	s_docGen.fetch_add( 1, std::memory_order_release );
+}
+
+void Document::on_change( pugi::xml_node nd, ChangeTypeE type )
+{
+	// setters run of one document on one thread, so cache the last lookup and skip lock and map
+	static thread_local const pugi::xml_node_struct * t_root = nullptr;
+	static thread_local Document * t_doc = nullptr;
+	static thread_local uint32_t t_gen = 0;
+	const pugi::xml_node_struct * root = nd.root().internal_object();
+	if( root != t_root || s_docGen.load( std::memory_order_acquire ) != t_gen ) {
+		std::lock_guard<std::mutex> guard( s_docMutex );
+		auto it = s_docMap.find( root );
+		t_doc = ( it != s_docMap.end() ) ? it->second : nullptr;
+		t_root = root;
+		t_gen = s_docGen.load( std::memory_order_relaxed );
+	}
+	if( t_doc != nullptr )
+		t_doc->handle_change( nd, type );
+	return;
+}
+
+void Document::handle_change( pugi::xml_node nd, ChangeTypeE type )
+{
+	m_isModified = true;
+	pugi::xml_node body = m_doc.document_element().first_child();
+
+	if( m_elemIndexValid && type != ChangeTypeE::MODIFY && nd.parent() == body )
+		update_element_index( nd, type );
+	if( m_idIndexValid ) {
+		if( type == ChangeTypeE::INSERT )
+			add_id_subtree( nd );
+		else if( type == ChangeTypeE::REMOVE )
+			remove_id_subtree( nd );
+	}
+	if( !m_tableGrid.empty() )
+		update_table_grid( nd, type );
+
+	// any change under top level child make its original bytes stale
+	if( !m_bodyRange.empty() ) {
+		pugi::xml_node top = nd;
+		while( !top.empty() && top.parent() != body )
+			top = top.parent();
+		if( !top.empty() )
+			m_bodyRange.erase( top.internal_object() );
+	}
+	return;
+}
+
 int Document::load_style()
 {
 	pugi::xml_document doc;
@@ -259,6 +554,11 @@ int Document::load_style()
 			style.m_id = id;
 			style.m_type = nd.attribute( "w:type" ).value();
 			style.m_name = nd.child( "w:name" ).attribute( "w:val" ).value();
+			style.m_basedOn = nd.child( "w:basedOn" ).attribute( "w:val" ).value();
+			style.m_default = nd.attribute( "w:default" ).as_bool();
+			style.m_format = ParaFormat();
+			style.m_format.Load( nd.child( "w:pPr" ) );
+			style.m_format.m_run.Load( nd.child( "w:rPr" ) );
 			pugi::xml_node ppr = nd.child( "w:pPr" );
 			pugi::xml_node numpr = ppr.child( "w:numPr" );
 			if( numpr ) {
@@ -283,7 +583,12 @@ int Document::load_style()
 				style.m_numLevel = 0;
 			}
 		}
-		else if( strcmp( nd.name(), "w:docDefaults" ) == 0 || strcmp( nd.name(), "w:latentStyles" ) == 0 ) {
+		else if( strcmp( nd.name(), "w:docDefaults" ) == 0 ) {
+			m_docDefault = ParaFormat();
+			m_docDefault.Load( nd.child( "w:pPrDefault" ).child( "w:pPr" ) );
+			m_docDefault.m_run.Load( nd.child( "w:rPrDefault" ).child( "w:rPr" ) );
+		}
+		else if( strcmp( nd.name(), "w:latentStyles" ) == 0 ) {
 			// Ignore
 			continue;
 		}
@@ -293,9 +598,109 @@ int Document::load_style()
 			continue;
 		}
 	}
+	// name is final after all w:style
+	m_styleName.clear();
+	m_styleNameNoCase.clear();
+	m_styleNameCount.clear();
+	m_defaultParaStyle = nullptr;
+	m_styleFormat.clear();
+	for( auto & it : m_style ) {
+		add_style_name( it.second );
+		if( it.second.m_default && it.second.m_type == "paragraph" && m_defaultParaStyle == nullptr )
+			m_defaultParaStyle = &it.second;
+	}
 	return SPD_ERR_OK;
 }
 
+size_t Document::NoCaseHash::operator()( std::string_view s ) const
+{
+	// fnv-1a of lower case
+	uint64_t h = 14695981039346656037ULL;
+	for( char ch : s ) {
+		uint8_t c = (uint8_t)ch;
+		if( c >= 'A' && c <= 'Z' )
+			c = (uint8_t)( c + 'a' - 'A' );
+		h = ( h ^ c ) * 1099511628211ULL;
+	}
+	return (size_t)h;
+}
+
+bool Document::NoCaseEqual::operator()( std::string_view a, std::string_view b ) const
+{
+	if( a.size() != b.size() )
+		return false;
+	for( size_t i = 0; i < a.size(); ++i ) {
+		uint8_t ca = (uint8_t)a[i], cb = (uint8_t)b[i];
+		if( ca == cb )
+			continue;
+		if( ca >= 'A' && ca <= 'Z' )
+			ca = (uint8_t)( ca + 'a' - 'A' );
+		if( cb >= 'A' && cb <= 'Z' )
+			cb = (uint8_t)( cb + 'a' - 'A' );
+		if( ca != cb )
+			return false;
+	}
+	return true;
+}
+
+void Document::add_style_name( const StyleLite & style )
+{
+	if( style.m_name.empty() )
+		return;
+	++m_styleNameCount[style.m_name];
+	index_style_name( style );
+	return;
+}
+
+void Document::index_style_name( const StyleLite & style )
+{
+	// keep the first in id order, same as scan of m_style. key always view name of its own style
+	auto add = [&style]( auto & index ) {
+		auto it = index.find( style.m_name );
+		if( it != index.end() ) {
+			if( it->second->m_id < style.m_id )
+				return;
+			index.erase( it );
+		}
+		index.emplace( std::string_view( style.m_name ), &style );
+	};
+	add( m_styleName );
+	add( m_styleNameNoCase );
+	return;
+}
+
+void Document::remove_style_name( const StyleLite & style )
+{
+	if( style.m_name.empty() )
+		return;
+	auto it = m_styleName.find( style.m_name );
+	bool erased = false;
+	if( it != m_styleName.end() && it->second == &style ) {
+		m_styleName.erase( it );
+		erased = true;
+	}
+	auto it2 = m_styleNameNoCase.find( style.m_name );
+	if( it2 != m_styleNameNoCase.end() && it2->second == &style ) {
+		m_styleNameNoCase.erase( it2 );
+		erased = true;
+	}
+	auto cit = m_styleNameCount.find( style.m_name );
+	int left = 0;
+	if( cit != m_styleNameCount.end() ) {
+		left = --cit->second;
+		if( left <= 0 )
+			m_styleNameCount.erase( cit );
+	}
+	if( !erased || left <= 0 )
+		return;
+	// the name is shared by other style ( maybe only in case ), the first of them take the place
+	for( auto & other : m_style ) {
+		if( &other.second != &style && NoCaseEqual()( other.second.m_name, style.m_name ) )
+			index_style_name( other.second );
+	}
+	return;
+}
+
 int Document::load_rela()
 {
 	pugi::xml_document doc;
@@ -358,10 +763,684 @@ Element Document::GetFirstElement() const
 	return Element( nd );
 }
 
+void Document::build_element_index() const
+{
+	m_elemIndex.clear();
+	for( Element ele = GetFirstElement(); ele.IsValid(); ele = ele.GetNext() ) {
+		m_elemIndex.push_back( ele.m_nd );
+	}
+	m_elemIndexValid = true;
+	m_elemIndexEdit = 0;
+	return;
+}
+
+// append is O(1), middle insert / remove is O(n) of find and move, so many middle edit since
+// last rebuild ( bulk insert, delete range ) drop the index and rebuild once on next lookup
+// lookup never touch the counter, it is read only once index is valid ( shared by worker thread )
+void Document::update_element_index( pugi::xml_node nd, ChangeTypeE type )
+{
+	// first child is always in index even if it should skip, just rebuild
+	if( nd == nd.parent().first_child() ) {
+		m_elemIndexValid = false;
+		return;
+	}
+	if( type == ChangeTypeE::INSERT ) {
+		// new child is Paragraph or Table, position is after its previous sibling
+		pugi::xml_node prev = nd.previous_sibling();
+		if( !m_elemIndex.empty() && m_elemIndex.back() == prev ) {
+			m_elemIndex.push_back( nd );
+			return;
+		}
+		if( ++m_elemIndexEdit > MAX_ELEM_INDEX_EDIT ) {
+			m_elemIndexValid = false;
+			m_elemIndexEdit = 0;
+			return;
+		}
+		auto it = std::find( m_elemIndex.begin(), m_elemIndex.end(), prev );
+		if( it == m_elemIndex.end() ) {
+			m_elemIndexValid = false;  // previous sibling is skipped node
+			return;
+		}
+		m_elemIndex.insert( it + 1, nd );
+	}
+	else if( type == ChangeTypeE::REMOVE ) {
+		if( !m_elemIndex.empty() && m_elemIndex.back() == nd ) {
+			m_elemIndex.pop_back();
+			return;
+		}
+		if( ++m_elemIndexEdit > MAX_ELEM_INDEX_EDIT ) {
+			m_elemIndexValid = false;
+			m_elemIndexEdit = 0;
+			return;
+		}
+		auto it = std::find( m_elemIndex.begin(), m_elemIndex.end(), nd );
+		if( it != m_elemIndex.end() )
+			m_elemIndex.erase( it );
+	}
+	return;
+}
+
+int Document::GetElementCount() const
+{
+	if( !m_elemIndexValid )
+		build_element_index();
+	return (int)m_elemIndex.size();
+}
+
+Element Document::GetElementAt( int idx ) const
+{
+	if( !m_elemIndexValid )
+		build_element_index();
+	if( idx < 0 || idx >= (int)m_elemIndex.size() )
+		return Element();
+	return Element( m_elemIndex[idx] );
+}
+
+ElementRange Document::GetElementRange( int first, int num ) const
+{
+	int count = GetElementCount();
+	if( first < 0 || num <= 0 || first >= count )
+		return ElementRange( end(), end() );
+	int last = ( num > count - first ) ? count : first + num;
+	return ElementRange( ElementIterator( GetElementAt( first ) ), ElementIterator( GetElementAt( last ) ) );
+}
+
+std::vector<ElementRange> Document::SplitElementRange( int num ) const
+{
+	std::vector<ElementRange> ranges;
+	int count = GetElementCount();
+	if( num <= 0 || count == 0 )
+		return ranges;
+	if( num > count )
+		num = count;
+	ranges.reserve( num );
+	for( int i = 0; i < num; ++i ) {
+		int first = (int)( (int64_t)count * i / num );
+		int last = (int)( (int64_t)count * ( i + 1 ) / num );
+		ranges.push_back( GetElementRange( first, last - first ) );
+	}
+	return ranges;
+}
+
+// pre-order walk of nd and its descendant, without recursion
+template< class F >
+static void for_each_subtree( pugi::xml_node nd, F func )
+{
+	pugi::xml_node cur = nd;
+	while( !cur.empty() ) {
+		func( cur );
+		if( !cur.first_child().empty() ) {
+			cur = cur.first_child();
+			continue;
+		}
+		while( cur != nd && cur.next_sibling().empty() )
+			cur = cur.parent();
+		if( cur == nd )
+			break;
+		cur = cur.next_sibling();
+	}
+	return;
+}
+
+// w14:paraId of w:p and w:tr, valid value is ( 0, 0x80000000 ), return 0 if not exist
+static uint32_t get_para_id( pugi::xml_node nd )
+{
+	TagIdE tag = Element::GetTagId( nd );
+	if( tag != TagIdE::W_P && tag != TagIdE::W_TR )
+		return 0;
+	const char * str = nd.attribute( "w14:paraId" ).value();
+	if( str[0] == '\0' )
+		return 0;
+	char * end = nullptr;
+	unsigned long id = strtoul( str, &end, 16 );
+	if( *end != '\0' || id == 0 || id >= 0x80000000UL )
+		return 0;
+	return (uint32_t)id;
+}
+
+void Document::build_id_index() const
+{
+	m_idNode.clear();
+	m_nodeId.clear();
+	add_id_subtree( m_doc.document_element().first_child() );
+	m_idIndexValid = true;
+	return;
+}
+
+void Document::add_id_subtree( pugi::xml_node nd ) const
+{
+	for_each_subtree( nd, [this]( pugi::xml_node cur ) {
+		uint32_t id = get_para_id( cur );
+		// duplicate paraId ( copied paragraph ) keep the first one, later one get assigned id
+		if( id != 0 && m_idNode.emplace( id, cur.internal_object() ).second )
+			m_nodeId[cur.internal_object()] = id;
+	} );
+	return;
+}
+
+void Document::remove_id_subtree( pugi::xml_node nd )
+{
+	if( m_nodeId.empty() )
+		return;
+	for_each_subtree( nd, [this]( pugi::xml_node cur ) {
+		auto it = m_nodeId.find( cur.internal_object() );
+		if( it != m_nodeId.end() ) {
+			m_idNode.erase( it->second );
+			m_nodeId.erase( it );
+		}
+	} );
+	return;
+}
+
+const TableGrid * Document::GetTableGrid( const Table & tbl ) const
+{
+	if( tbl.GetType() != ElementTypeE::TABLE || tbl.m_nd.root() != m_doc )
+		return nullptr;
+	std::unique_ptr<TableGrid> & grid = m_tableGrid[tbl.m_nd.internal_object()];
+	if( !grid ) {
+		grid.reset( new TableGrid() );
+		grid->Build( tbl );
+	}
+	return grid.get();
+}
+
+void Document::update_table_grid( pugi::xml_node nd, ChangeTypeE type )
+{
+	// removed table may be reused by new node with same address, drop all grid in subtree
+	if( type == ChangeTypeE::REMOVE ) {
+		for_each_subtree( nd, [this]( pugi::xml_node cur ) {
+			if( Element::GetTagId( cur ) == TagIdE::W_TBL )
+				m_tableGrid.erase( cur.internal_object() );
+		} );
+	}
+
+	// only change of table / row / cell itself change the grid, not the content in cell
+	TagIdE tag = Element::GetTagId( nd );
+	if( tag != TagIdE::W_TBL && tag != TagIdE::W_TR && tag != TagIdE::W_TC )
+		return;
+	pugi::xml_node tbl = nd;
+	while( !tbl.empty() && Element::GetTagId( tbl ) != TagIdE::W_TBL )
+		tbl = tbl.parent();
+	if( !tbl.empty() )
+		m_tableGrid.erase( tbl.internal_object() );
+	return;
+}
+
+int Document::ExtractTables( std::vector<TableColumns> & tables ) const
+{
+	// walk block level node only, text in paragraph is read by Table::ExtractColumns()
+	int num = 0;
+	std::vector<int> outer;  // index of table for each w:tbl ancestor
+	pugi::xml_node body = m_doc.document_element().first_child();
+	pugi::xml_node cur = body.first_child();
+	while( !cur.empty() ) {
+		TagIdE tag = Element::GetTagId( cur );
+		bool descend = ( tag != TagIdE::W_P && tag != TagIdE::W_R && cur.type() == pugi::node_element );
+		if( tag == TagIdE::W_TBL ) {
+			if( num >= (int)tables.size() )
+				tables.emplace_back();
+			TableColumns & tc = tables[num];
+			Table( Element( cur, ElementTypeE::TABLE ) ).ExtractColumns( tc );
+			tc.m_parent = outer.empty() ? -1 : outer.back();
+			if( !cur.first_child().empty() )
+				outer.push_back( num );  // pop when walk back to its parent
+			++num;
+		}
+		if( descend && !cur.first_child().empty() ) {
+			cur = cur.first_child();
+			continue;
+		}
+		while( cur != body && cur.next_sibling().empty() ) {
+			cur = cur.parent();
+			if( Element::GetTagId( cur ) == TagIdE::W_TBL )
+				outer.pop_back();
+		}
+		if( cur == body )
+			break;
+		cur = cur.next_sibling();
+	}
+	tables.resize( num );
+	return num;
+}
+
+void Document::collect_tables( std::vector<Table> & tables ) const
+{
+	// collect first, repair may add row / cell under the walk
+	pugi::xml_node body = m_doc.document_element().first_child();
+	pugi::xml_node cur = body.first_child();
+	while( !cur.empty() ) {
+		TagIdE tag = Element::GetTagId( cur );
+		if( tag == TagIdE::W_TBL )
+			tables.push_back( Table( Element( cur, ElementTypeE::TABLE ) ) );
+		bool descend = ( tag != TagIdE::W_P && tag != TagIdE::W_R && cur.type() == pugi::node_element );
+		if( descend && !cur.first_child().empty() ) {
+			cur = cur.first_child();
+			continue;
+		}
+		while( cur != body && cur.next_sibling().empty() )
+			cur = cur.parent();
+		if( cur == body )
+			break;
+		cur = cur.next_sibling();
+	}
+	return;
+}
+
+int Document::ValidateTables( std::vector<TableIssue> * issues ) const
+{
+	std::vector<Table> tables;
+	collect_tables( tables );
+	if( issues != nullptr )
+		issues->clear();
+	std::vector<TableIssue> one;
+	int num = 0;
+	for( size_t i = 0; i < tables.size(); ++i ) {
+		int ret = tables[i].Validate( issues != nullptr ? &one : nullptr );
+		if( ret <= 0 )
+			continue;
+		num += ret;
+		if( issues != nullptr ) {
+			for( TableIssue & issue : one ) {
+				issue.m_table = (int)i;
+				issues->push_back( issue );
+			}
+		}
+	}
+	return num;
+}
+
+int Document::RepairTables()
+{
+	std::vector<Table> tables;
+	collect_tables( tables );
+	int num = 0;
+	for( Table & tbl : tables ) {
+		int ret = tbl.Repair();
+		if( ret > 0 )
+			num += ret;
+	}
+	if( num > 0 )
+		SPD_PR_INFO( "repair %d issue in %d table", num, (int)tables.size() );
+	return num;
+}
+
+// text of sibling [first, last) and their descendant, last is empty means to the end
+void Document::extract_text( pugi::xml_node first, pugi::xml_node last, const TextOption & opt, std::string & out )
+{
+	// return true if descend into child
+	auto enter = [&]( pugi::xml_node nd ) -> bool {
+		if( nd.type() != pugi::node_element )
+			return false;
+		TagIdE tag = Element::GetTagId( nd );
+		switch( tag )
+		{
+		case TagIdE::W_T:
+			out.append( nd.text().get() );
+			return false;
+		case TagIdE::UNKNOWN:
+			break;
+		case TagIdE::W_P:
+		case TagIdE::W_R:
+		case TagIdE::W_HYPERLINK:
+		case TagIdE::W_TBL:
+		case TagIdE::W_TR:
+		case TagIdE::W_TC:
+			return true;
+		default:
+			return false;  // property, drawing, bookmark ...
+		}
+		const char * name = nd.name();
+		if( strcmp( name, "w:tab" ) == 0 ) {
+			// w:tab in w:pPr/w:tabs is not reached, property is not descended
+			out.append( opt.m_tab );
+			return false;
+		}
+		if( strcmp( name, "w:br" ) == 0 || strcmp( name, "w:cr" ) == 0 ) {
+			out.append( opt.m_break );
+			return false;
+		}
+		if( strcmp( name, "w:noBreakHyphen" ) == 0 ) {
+			out.push_back( '-' );
+			return false;
+		}
+		// deleted text, field code, and drawing / vml content is not in reading order
+		if( strcmp( name, "w:del" ) == 0 || strcmp( name, "w:instrText" ) == 0 || strcmp( name, "w:pict" ) == 0
+				|| strcmp( name, "w:fldData" ) == 0 || strcmp( name, "w:sdtPr" ) == 0 || strcmp( name, "w:sdtEndPr" ) == 0 )
+			return false;
+		return true;  // w:ins, w:sdt, w:sdtContent, w:smartTag, w:fldSimple ...
+	};
+	auto leave = [&]( pugi::xml_node nd ) {
+		switch( Element::GetTagId( nd ) )
+		{
+		case TagIdE::W_P:
+			// last paragraph of cell is ended by cell separator
+			if( Element::GetTagId( nd.parent() ) != TagIdE::W_TC || !nd.next_sibling( "w:p" ).empty() )
+				out.append( opt.m_paraEnd );
+			break;
+		case TagIdE::W_TC:
+			if( !nd.next_sibling( "w:tc" ).empty() )
+				out.append( opt.m_cellSep );
+			break;
+		case TagIdE::W_TR:
+			out.append( opt.m_rowEnd );
+			break;
+		default:
+			break;
+		}
+	};
+
+	pugi::xml_node top = first.parent();
+	pugi::xml_node cur = first;
+	while( !cur.empty() && cur != last ) {
+		if( enter( cur ) && !cur.first_child().empty() ) {
+			cur = cur.first_child();
+			continue;
+		}
+		// leave cur and its finished ancestor, stop at top level
+		for( ;; ) {
+			leave( cur );
+			if( !cur.next_sibling().empty() || cur.parent() == top )
+				break;
+			cur = cur.parent();
+		}
+		cur = cur.next_sibling();
+	}
+	return;
+}
+
+int Document::ExtractText( TextSink & sink, const TextOption & opt ) const
+{
+	pugi::xml_node body = m_doc.document_element().first_child();
+	if( body.first_child().empty() )
+		return SPD_ERR_OK;
+
+	// element index is built here, worker thread only read xml
+	int count = GetElementCount();
+	int num = opt.m_threadNum;
+	if( num <= 0 )
+		num = (int)std::thread::hardware_concurrency();
+	int minslice = opt.m_minSlice > 0 ? opt.m_minSlice : 1;
+	if( num > count / minslice )
+		num = count / minslice;
+	if( num < 1 )
+		num = 1;
+
+	// slice i is [begin[i], begin[i + 1]), first slice begin at first child for skipped node before first Element
+	std::vector<pugi::xml_node> begin( num + 1 );
+	begin[0] = body.first_child();
+	for( int i = 1; i < num; ++i )
+		begin[i] = m_elemIndex[(int64_t)count * i / num];
+	std::vector<std::string> bufs( num );
+	std::vector<std::thread> workers;
+	workers.reserve( num - 1 );
+	for( int i = 1; i < num; ++i )
+		workers.emplace_back( extract_text, begin[i], begin[i + 1], std::cref( opt ), std::ref( bufs[i] ) );
+	extract_text( begin[0], begin[1], opt, bufs[0] );
+	for( std::thread & t : workers )
+		t.join();
+
+	for( const std::string & buf : bufs ) {
+		if( buf.empty() )
+			continue;
+		int ret = sink.Write( buf.data(), buf.size() );
+		if( ret < 0 )
+			return ret;
+	}
+	return SPD_ERR_OK;
+}
+
+// func( w:p ) for every paragraph under body in document order, paragraph is not descended
+template< class F >
+static void for_each_paragraph( pugi::xml_node body, F func )
+{
+	pugi::xml_node cur = body.first_child();
+	while( !cur.empty() ) {
+		TagIdE tag = Element::GetTagId( cur );
+		if( tag == TagIdE::W_P )
+			func( cur );
+		bool descend = ( tag != TagIdE::W_P && cur.type() == pugi::node_element );
+		if( descend && !cur.first_child().empty() ) {
+			cur = cur.first_child();
+			continue;
+		}
+		while( cur != body && cur.next_sibling().empty() )
+			cur = cur.parent();
+		if( cur == body )
+			break;
+		cur = cur.next_sibling();
+	}
+	return;
+}
+
+int Document::Replace( const TextReplacer & rep )
+{
+	// only run under paragraph is changed, walk is not affected
+	int num = 0;
+	for_each_paragraph( m_doc.document_element().first_child(), [&]( pugi::xml_node pnd ) {
+		Paragraph par( Element( pnd, ElementTypeE::PARAGRAPH ) );
+		num += par.Replace( rep );
+	} );
+	return num;
+}
+
+static inline uint8_t fold_ascii( uint8_t c )
+{
+	return ( c >= 'A' && c <= 'Z' ) ? (uint8_t)( c + 'a' - 'A' ) : c;
+}
+
+static inline bool is_word_char( uint8_t c )
+{
+	return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '_';
+}
+
+int Document::Find( std::string_view pattern, std::vector<FindResult> & results, const FindOption & opt ) const
+{
+	results.clear();
+	if( pattern.empty() )
+		return 0;
+	std::string pat( pattern );
+	if( opt.m_ignoreCase ) {
+		for( char & c : pat )
+			c = (char)fold_ascii( (uint8_t)c );
+	}
+	const uint8_t first = (uint8_t)pat[0];
+	const uint8_t firstUp = ( opt.m_ignoreCase && first >= 'a' && first <= 'z' ) ? (uint8_t)( first - 'a' + 'A' ) : first;
+
+	// text of first w:t of each run, same as Paragraph::GetText()
+	struct Piece
+	{
+		const char * m_data;
+		size_t m_len;
+		size_t m_begin;  // offset in paragraph
+		pugi::xml_node m_run;
+	};
+	std::vector<Piece> pieces;  // reused for every paragraph
+	bool full = false;
+
+	auto find_par = [&]( pugi::xml_node pnd ) {
+		if( full )
+			return;
+		pieces.clear();
+		size_t total = 0;
+		auto add_run = [&]( pugi::xml_node rnd ) {
+			const char * text = rnd.child( "w:t" ).text().get();
+			size_t len = strlen( text );
+			if( len > 0 )
+				pieces.push_back( Piece{ text, len, total, rnd } );
+			total += len;
+		};
+		for( pugi::xml_node cnd = pnd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
+			TagIdE tag = Element::GetTagId( cnd );
+			if( tag == TagIdE::W_R )
+				add_run( cnd );
+			else if( tag == TagIdE::W_HYPERLINK ) {
+				for( pugi::xml_node cnd2 = cnd.child( "w:r" ); !cnd2.empty(); cnd2 = cnd2.next_sibling( "w:r" ) )
+					add_run( cnd2 );
+			}
+		}
+		if( total < pat.size() )
+			return;
+
+		size_t i = 0, off = 0;
+		while( i < pieces.size() ) {
+			const Piece & pc = pieces[i];
+			// candidate by first byte, memchr is vectorized by libc
+			const char * p = (const char *)memchr( pc.m_data + off, first, pc.m_len - off );
+			if( firstUp != first ) {
+				const char * p2 = (const char *)memchr( pc.m_data + off, firstUp, ( p ? p : pc.m_data + pc.m_len ) - ( pc.m_data + off ) );
+				if( p2 != nullptr )
+					p = p2;
+			}
+			if( p == nullptr ) {
+				++i;
+				off = 0;
+				continue;
+			}
+			size_t c = p - pc.m_data;
+
+			// verify from candidate, walk to next piece if cross run
+			size_t ei = i, eo = c, k = 0;
+			bool ok = true;
+			while( k < pat.size() ) {
+				if( eo == pieces[ei].m_len ) {
+					if( !opt.m_crossRun || ei + 1 >= pieces.size() ) {
+						ok = false;
+						break;
+					}
+					++ei;
+					eo = 0;
+				}
+				uint8_t ch = (uint8_t)pieces[ei].m_data[eo];
+				if( ( opt.m_ignoreCase ? fold_ascii( ch ) : ch ) != (uint8_t)pat[k] ) {
+					ok = false;
+					break;
+				}
+				++eo;
+				++k;
+			}
+			if( ok && opt.m_wholeWord ) {
+				// neighbor char is in paragraph text, even in other run
+				if( c > 0 )
+					ok = !is_word_char( (uint8_t)pc.m_data[c - 1] );
+				else if( i > 0 )
+					ok = !is_word_char( (uint8_t)pieces[i - 1].m_data[pieces[i - 1].m_len - 1] );
+				if( ok && eo < pieces[ei].m_len )
+					ok = !is_word_char( (uint8_t)pieces[ei].m_data[eo] );
+				else if( ok && ei + 1 < pieces.size() )
+					ok = !is_word_char( (uint8_t)pieces[ei + 1].m_data[0] );
+			}
+			if( !ok ) {
+				off = c + 1;
+				continue;
+			}
+
+			FindResult res;
+			res.m_par = Paragraph( Element( pnd, ElementTypeE::PARAGRAPH ) );
+			res.m_offset = pc.m_begin + c;
+			res.m_run = Run( Element( pc.m_run ) );
+			res.m_runOffset = c;
+			res.m_endRun = Run( Element( pieces[ei].m_run ) );
+			res.m_endOffset = eo;
+			results.push_back( res );
+			if( opt.m_maxResult > 0 && (int)results.size() >= opt.m_maxResult ) {
+				full = true;
+				return;
+			}
+			// continue after match
+			i = ei;
+			off = eo;
+		}
+	};
+	for_each_paragraph( m_doc.document_element().first_child(), find_par );
+	return (int)results.size();
+}
+
+uint32_t Document::GetElementId( const Element & ele ) const
+{
+	if( !ele.IsValid() || ele.m_nd.root() != m_doc )
+		return 0;
+	if( !m_idIndexValid )
+		build_id_index();
+	auto it = m_nodeId.find( ele.m_nd.internal_object() );
+	if( it != m_nodeId.end() )
+		return it->second;
+
+	uint32_t id = 0;
+	do {
+		m_idSeq = ( m_idSeq + 1 ) & 0x7FFFFFFF;
+		id = 0x80000000 | m_idSeq;
+	} while( m_idNode.find( id ) != m_idNode.end() );
+	m_idNode[id] = ele.m_nd.internal_object();
+	m_nodeId[ele.m_nd.internal_object()] = id;
+	return id;
+}
+
+Element Document::FindElementById( uint32_t id ) const
+{
+	if( id == 0 )
+		return Element();
+	if( !m_idIndexValid )
+		build_id_index();
+	auto it = m_idNode.find( id );
+	if( it == m_idNode.end() )
+		return Element();
+	return Element( pugi::xml_node( it->second ) );
+}
+
+int Document::query_nodes( const std::string & xpath, const Element & ctx, pugi::xpath_node_set & nodes ) const
+{
+	auto it = m_query.find( xpath );
+	if( it == m_query.end() ) {
+		// empty query is the sentinel of bad xpath, cached too and not compile again.
+		// pugixml with exceptions ( system library ) throw on bad xpath instead of set result
+		it = m_query.emplace( xpath, pugi::xpath_query() ).first;
+#ifndef PUGIXML_NO_EXCEPTIONS
+		try {
+			it->second = pugi::xpath_query( xpath.c_str() );
+		}
+		catch( const pugi::xpath_exception & e ) {
+			SPD_PR_DEBUG( "bad xpath [%s], err : %s", xpath.c_str(), e.what() );
+		}
+#else
+		it->second = pugi::xpath_query( xpath.c_str() );
+		if( !it->second )
+			SPD_PR_DEBUG( "bad xpath [%s], err : %s", xpath.c_str(), it->second.result().description() );
+#endif // PUGIXML_NO_EXCEPTIONS
+	}
+	const pugi::xpath_query & query = it->second;
+	if( !query )
+		return SPD_ERR_BAD_PARAM;
+	if( query.return_type() != pugi::xpath_type_node_set ) {
+		SPD_PR_DEBUG( "xpath [%s] not return node set", xpath.c_str() );
+		return SPD_ERR_BAD_PARAM;
+	}
+
+	pugi::xml_node cnd = ctx.IsValid() ? ctx.m_nd : m_doc.document_element().first_child();
+	nodes = query.evaluate_node_set( cnd );
+	nodes.sort();
+	return (int)nodes.size();
+}
+
+int Document::Query( const std::string & xpath, std::vector<Element> & result, const Element & ctx ) const
+{
+	pugi::xpath_node_set nodes;
+	int ret = query_nodes( xpath, ctx, nodes );
+	if( ret < 0 )
+		return ret;
+	result.clear();
+	for( const pugi::xpath_node & xnd : nodes ) {
+		// attribute or text match is not Element, use "parent::*" or ".." in xpath to get its owner
+		if( xnd.node().type() == pugi::node_element )
+			result.push_back( Element( xnd.node() ) );
+	}
+	return (int)result.size();
+}
+
 Paragraph Document::AddChildParagraph( bool add_back )
 {
 	pugi::xml_node parent = m_doc.document_element().first_child();
 	pugi::xml_node nd = add_back ? parent.append_child( "w:p" ) : parent.prepend_child( "w:p" );
+	handle_change( nd, ChangeTypeE::INSERT );
 	return Paragraph( Element( nd ) );
 }
 
@@ -371,12 +1450,16 @@ Table Document::AddChildTable( bool add_back )
 	pugi::xml_node nd = add_back ? parent.append_child( "w:tbl" ) : parent.prepend_child( "w:tbl" );
 	Table tbl = Element( nd );
 	tbl.Reset();
+	handle_change( nd, ChangeTypeE::INSERT );
 	return tbl;
 }
 
 int Document::DelChild( Element & child )
 {
 	pugi::xml_node parent = m_doc.document_element().first_child();
+	if( child.m_nd.parent() != parent )
+		return SPD_ERR_BAD_PARAM;
+	handle_change( child.m_nd, ChangeTypeE::REMOVE );
 	bool ret = parent.remove_child( child.m_nd );
 	return ret ? SPD_ERR_OK : SPD_ERR_BAD_PARAM;
 }
@@ -384,42 +1467,101 @@ int Document::DelChild( Element & child )
 int Document::DelAllChild()
 {
 	pugi::xml_node parent = m_doc.document_element().first_child();
+	for( pugi::xml_node nd = parent.first_child(); !nd.empty(); nd = nd.next_sibling() )
+		handle_change( nd, ChangeTypeE::REMOVE );
 	parent.remove_children();
 	return SPD_ERR_OK;
 }
 
 const char * Document::GetStyleName( const char * id ) const
 {
-	if( id == nullptr || id[0] == '\0' )
-		return "";
-	auto it = m_style.find( std::string( id ) );
-	if( it == m_style.end() )
-		return "";
-	return it->second.m_name.c_str();
+	const StyleLite * style = GetStyle( id );
+	return ( style != nullptr ) ? style->m_name.c_str() : "";
 }
 
-const char * Document::GetStyleId( const char * name ) const
+const char * Document::GetStyleId( const char * name, bool ignoreCase ) const
 {
 	if( name == nullptr || name[0] == '\0' )
 		return "";
-	auto it = m_style.begin();
-	for( ; it != m_style.end(); ++it ) {
-		if( it->second.m_name == name )
-			return it->second.m_id.c_str();
-	}
-	return "";
+	const StyleLite * style = GetStyleByName( name, ignoreCase );
+	return ( style != nullptr ) ? style->m_id.c_str() : "";
 }
 
 const StyleLite * Document::GetStyle( const char* id ) const
 {
 	if( id == nullptr || id[0] == '\0' )
 		return nullptr;
-	auto it = m_style.find( std::string( id ) );
+	return GetStyle( std::string_view( id ) );
+}
+
+const StyleLite * Document::GetStyle( std::string_view id ) const
+{
+	auto it = m_style.find( id );
 	if( it == m_style.end() )
 		return nullptr;
 	return &it->second;
 }
 
+const StyleLite * Document::GetStyleByName( std::string_view name, bool ignoreCase ) const
+{
+	if( ignoreCase ) {
+		auto it = m_styleNameNoCase.find( name );
+		return ( it != m_styleNameNoCase.end() ) ? it->second : nullptr;
+	}
+	auto it = m_styleName.find( name );
+	return ( it != m_styleName.end() ) ? it->second : nullptr;
+}
+
+const Document::StyleFormat * Document::get_style_format( const StyleLite * style ) const
+{
+	auto it = m_styleFormat.find( style );
+	if( it != m_styleFormat.end() )
+		return &it->second;
+
+	// basedOn chain up to a memoized one, loop is cut at style num
+	std::vector<const StyleLite *> chain;
+	const StyleFormat * base = nullptr;
+	for( const StyleLite * cur = style; cur != nullptr && chain.size() <= m_style.size(); ) {
+		auto it2 = m_styleFormat.find( cur );
+		if( it2 != m_styleFormat.end() ) {
+			base = &it2->second;
+			break;
+		}
+		chain.push_back( cur );
+		cur = cur->m_basedOn.empty() ? nullptr : GetStyle( std::string_view( cur->m_basedOn ) );
+	}
+	// from the root of chain, node of unordered_map is stable
+	for( auto rit = chain.rbegin(); rit != chain.rend(); ++rit ) {
+		StyleFormat & fmt = m_styleFormat[*rit];
+		if( base != nullptr )
+			fmt.m_chain = base->m_chain;
+		fmt.m_chain.Merge( ( *rit )->m_format );
+		fmt.m_full = m_docDefault;
+		fmt.m_full.Merge( fmt.m_chain );
+		base = &fmt;
+	}
+	return base;
+}
+
+const ParaFormat & Document::GetStyleFormat( const char * id ) const
+{
+	const StyleLite * style = ( id != nullptr && id[0] != '\0' ) ? GetStyle( id ) : nullptr;
+	if( style == nullptr )
+		style = m_defaultParaStyle;
+	if( style == nullptr )
+		return m_docDefault;
+	return get_style_format( style )->m_full;
+}
+
+const RunFormat & Document::GetCharStyleFormat( const char * id ) const
+{
+	static const RunFormat s_empty;
+	const StyleLite * style = GetStyle( id );
+	if( style == nullptr )
+		return s_empty;
+	return get_style_format( style )->m_chain.m_run;
+}
+
 std::vector< const StyleLite*> Document::GetAllStyle() const
 {
 	std::vector< const StyleLite* > ret;
@@ -433,7 +1575,21 @@ int Document::AddStyle( const StyleLite & style )
 {
 	if( style.m_id.empty() )
 		return SPD_ERR_BAD_PARAM;
-	m_style[style.m_id] = style;
+	// node of map is stable, only name index of old name is changed
+	auto it = m_style.find( style.m_id );
+	if( it == m_style.end() )
+		it = m_style.emplace( style.m_id, style ).first;
+	else {
+		remove_style_name( it->second );
+		it->second = style;
+	}
+	add_style_name( it->second );
+	if( it->second.m_default && it->second.m_type == "paragraph" )
+		m_defaultParaStyle = &it->second;
+	else if( m_defaultParaStyle == &it->second )
+		m_defaultParaStyle = nullptr;
+	m_styleFormat.clear();  // basedOn chain of other style may pass it
+	m_isModified = true;
 	return SPD_ERR_OK;
 }
 
@@ -460,6 +1616,7 @@ int Document::AddRelationship( const Relationship& rela )
 	if( rela.m_id.empty() )
 		return SPD_ERR_BAD_PARAM;
 	m_rela[rela.m_id] = rela;
+	m_isModified = true;
 	return SPD_ERR_OK;
 }
 
@@ -537,6 +1694,7 @@ int Document::SetEmbedData( const std::string & id, const std::vector<char> & da
 		return SPD_ERR_BAD_PARAM;
 	std::string name = std::string( "word/" ) + id;
 	m_files[name] = data;
+	m_isModified = true;
 	return SPD_ERR_OK;
 }
 
@@ -546,6 +1704,7 @@ int Document::SetEmbedData( const std::string & id, std::vector<char> && data )
 		return SPD_ERR_BAD_PARAM;
 	std::string name = std::string( "word/" ) + id;
 	m_files[name] = std::move(data);
+	m_isModified = true;
 	return SPD_ERR_OK;
 
 }
@@ -22,7 +22,10 @@
 
 #include <pugixml.hpp>
 #include <string>
+#include <string_view>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 BEGIN_NS_SPD
@@ -36,6 +39,10 @@ public:
 	std::string m_name;  // "headding 1", "heading 2", ... , "normal",
 	std::string m_numId; // empty means no numbering
 	int m_numLevel = -1;  // level start from 0, -1 means no numbering, 
+	// read from styles.xml for effective format, not written back by AddStyle()
+	std::string m_basedOn;
+	bool m_default = false;  // default style of its type
+	ParaFormat m_format;     // w:pPr and w:rPr ( in m_run ) of this style only
 };
 
 class SPD_API Relationship
@@ -47,6 +54,40 @@ public:
 	std::string m_targetMode;  // External
 };
 
+// plain text layout of Document::ExtractText()
+class SPD_API TextOption
+{
+public:
+	const char * m_paraEnd = "\n";  // after paragraph, between paragraph in cell
+	const char * m_cellSep = "\t";  // between cell in row
+	const char * m_rowEnd = "\n";   // after row
+	const char * m_tab = "\t";      // w:tab in run
+	const char * m_break = "\n";    // w:br, w:cr in run
+	int m_threadNum = 0;     // 0 means hardware concurrency, 1 means serial in caller thread
+	int m_minSlice = 256;    // at least top level Element num for each thread
+};
+
+class SPD_API FindOption
+{
+public:
+	bool m_ignoreCase = false;  // ascii only
+	bool m_wholeWord = false;   // not preceded or followed by ascii letter, digit or '_'
+	bool m_crossRun = true;     // match may span run, otherwise must be in one run
+	int m_maxResult = 0;        // 0 means no limit
+};
+
+// offset is byte of utf-8 text, same as GetText() of Paragraph and Run
+class SPD_API FindResult
+{
+public:
+	Paragraph m_par{ Element() };
+	size_t m_offset = 0;     // in paragraph text
+	Run m_run{ Element() };  // run where match begin
+	size_t m_runOffset = 0;  // in m_run text
+	Run m_endRun{ Element() };  // run where match end, same as m_run if not span
+	size_t m_endOffset = 0;     // end ( exclusive ) in m_endRun text
+};
+
 class SPD_API Document
 {
 public:
@@ -55,6 +96,7 @@ public:
 
 	int New();
 	int Open( const std::string & fname );
+	// if not modified since Open() or last Save(), just copy the source file
 	int Save( const std::string & fname = std::string{} );
 	int Close();
 	bool IsValid() const { return ! m_files.empty(); }
@@ -67,6 +109,50 @@ public:
 	ElementIterator begin() const { return ElementIterator( GetFirstElement() ); }
 	ElementIterator end() const { return ElementIterator(); }
 	ElementRange Children() const { return ElementRange( begin(), end() ); }
+	// top level Element of type T only ( Paragraph or Table )
+	template< class T > TypedElementRange<T> Children() const { return TypedElementRange<T>( m_doc.document_element().first_child().first_child() ); }
+
+	// random access of top level Element, same order as begin() / end()
+	// index is build lazily and not thread safe, call GetElementCount() before share to worker thread
+	// append is kept in O(1), middle insert / remove is O(n) each, many of them since last rebuild drop the index
+	int GetElementCount() const;
+	Element GetElementAt( int idx ) const;  // INVALID if idx out of range
+	ElementRange GetElementRange( int first, int num ) const;  // Element [first, first + num)
+	std::vector<ElementRange> SplitElementRange( int num ) const;  // split all Element to num contiguous range
+
+	// stable id of Element, w14:paraId if exist, otherwise assign one in memory ( >= 0x80000000, not saved )
+	// id is kept after other edit, until the Element is deleted. return 0 if ele invalid
+	uint32_t GetElementId( const Element & ele ) const;
+	Element FindElementById( uint32_t id ) const;  // INVALID if not found or deleted
+
+	// cached grid of tbl, rebuild lazily after its row / cell changed, nullptr if tbl invalid
+	// pointer is valid until next structure change of tbl, not thread safe
+	const TableGrid * GetTableGrid( const Table & tbl ) const;
+
+	// every table ( include nested table ) in document order in one walk, buffers of tables is reused
+	// return table num
+	int ExtractTables( std::vector<TableColumns> & tables ) const;
+	// Table::Validate() / Table::Repair() for every table ( include nested table ), return total issue num
+	int ValidateTables( std::vector<TableIssue> * issues = nullptr ) const;
+	int RepairTables();
+
+	// text of paragraph, hyperlink and table in reading order, deleted text and field code is skipped
+	// top level Element is split to slices and extracted by worker threads, output is same as serial
+	// document must not be modified during extract. return SPD_ERR_OK, or < 0 if sink failed
+	int ExtractText( TextSink & sink, const TextOption & opt = TextOption() ) const;
+
+	// Paragraph::Replace() for every paragraph in body ( include paragraph in table ), return replaced num
+	int Replace( const TextReplacer & rep );
+
+	// find pattern in text of every paragraph in body ( include paragraph in table ), w:t is scanned in place
+	// match is non-overlapping in document order, return match num
+	int Find( std::string_view pattern, std::vector<FindResult> & results, const FindOption & opt = FindOption() ) const;
+
+	// xpath query relative to ctx ( default is w:body ), ex : "w:tbl[w:tr[1]//w:t[contains(., 'Total')]]"
+	// compiled query is cached by string, not thread safe. return match num, or < 0 if bad xpath
+	int Query( const std::string & xpath, std::vector<Element> & result, const Element & ctx = Element() ) const;
+	// only match of type T ( Paragraph, Table, TCell ... ) is returned
+	template< class T > int Query( const std::string & xpath, std::vector<T> & result, const Element & ctx = Element() ) const;
 
 	// default is add to back, 
 	Paragraph AddChildParagraph( bool add_back = true );
@@ -75,8 +161,16 @@ public:
 	int DelAllChild();
 
 	const char * GetStyleName( const char * id ) const;
-	const char * GetStyleId( const char * name ) const;
+	const char * GetStyleId( const char * name, bool ignoreCase = false ) const;  // ignoreCase is ascii only, ex : "Heading 1"
 	const StyleLite * GetStyle( const char* id ) const;
+	const StyleLite * GetStyle( std::string_view id ) const;
+	// hash index of name, first style in id order if name is duplicated
+	const StyleLite * GetStyleByName( std::string_view name, bool ignoreCase = false ) const;
+	// resolved format of paragraph style : docDefaults + basedOn chain, default paragraph style if id not found
+	// memoized per style, reference is valid until next AddStyle() or Close(), not thread safe
+	const ParaFormat & GetStyleFormat( const char * id ) const;
+	// basedOn chain of character style only, to merge on paragraph style, empty if not found
+	const RunFormat & GetCharStyleFormat( const char * id ) const;
 	std::vector< const StyleLite *> GetAllStyle() const;
 	int AddStyle( const StyleLite& style );  // if style exist, update it
 	const Relationship * GetRelationship( const char * id ) const;
@@ -90,26 +184,105 @@ public:
 protected:
 	static int read_zip( const std::string & fname, std::map< std::string, std::vector<char> > & files );
 	static int write_zip( const std::string & fname, const std::map< std::string, std::vector<char> > & files );
+	static int copy_file( const std::string & src, const std::string & dst );
 
 	int parse_files();
 	int read_xml( const std::string & fname, pugi::xml_document * doc ) const;
 	int write_xml( const std::string & fname, const pugi::xml_document & doc );
+	int load_body_range();
+	int write_body_range();
+	void build_element_index() const;
+	void update_element_index( pugi::xml_node nd, ChangeTypeE type );
+	void build_id_index() const;
+	void add_id_subtree( pugi::xml_node nd ) const;
+	void remove_id_subtree( pugi::xml_node nd );
+	void collect_tables( std::vector<Table> & tables ) const;
+	static void extract_text( pugi::xml_node first, pugi::xml_node last, const TextOption & opt, std::string & out );
+	void update_table_grid( pugi::xml_node nd, ChangeTypeE type );
+	int query_nodes( const std::string & xpath, const Element & ctx, pugi::xpath_node_set & nodes ) const;
 	int load_style();
+	class StyleFormat
+	{
+	public:
+		ParaFormat m_chain;  // basedOn chain only
+		ParaFormat m_full;   // docDefaults + m_chain
+	};
+	const StyleFormat * get_style_format( const StyleLite * style ) const;
+	void add_style_name( const StyleLite & style );
+	void index_style_name( const StyleLite & style );  // name index only, not count
+	void remove_style_name( const StyleLite & style );
 	int load_rela();
 	int write_style();
 	int write_rela();
 
+	// change notify from Element, find the owner Document by xml root
+	friend class Element;
+	static void on_change( pugi::xml_node nd, ChangeTypeE type );
+	void handle_change( pugi::xml_node nd, ChangeTypeE type );
+	void register_doc();
+	void unregister_doc();
+
 private:
 	friend class SPDDebug;
 	std::string m_fname;
+	std::string m_srcName;  // file same as current content, empty if not exist
 	std::map< std::string, std::vector<char> > m_files;  // zip files, every file has an extra '\0'
 	bool m_isModified = false;
 	
 	pugi::xml_document m_doc;
-	std::map< std::string, StyleLite > m_style;
+	// byte range [begin, end) of untouched top level body child in "word/document.xml",
+	// modified child is removed, Save() only serialize child not in range
+	std::map< const pugi::xml_node_struct *, std::pair< size_t, size_t > > m_bodyRange;
+	size_t m_bodyHead = 0;  // end of "<w:body>", 0 means range not valid
+	size_t m_bodyTail = 0;  // begin of "</w:body>"
+	mutable std::vector<pugi::xml_node> m_elemIndex;  // top level Element index
+	mutable bool m_elemIndexValid = false;
+	mutable int m_elemIndexEdit = 0;  // middle insert / remove since last rebuild
+	static const int MAX_ELEM_INDEX_EDIT = 16;  // more is rebuild lazily
+	mutable std::unordered_map< uint32_t, pugi::xml_node_struct * > m_idNode;  // element id index, build lazily
+	mutable std::unordered_map< const pugi::xml_node_struct *, uint32_t > m_nodeId;
+	mutable uint32_t m_idSeq = 0;  // last assigned id
+	mutable bool m_idIndexValid = false;
+	mutable std::unordered_map< const pugi::xml_node_struct *, std::unique_ptr<TableGrid> > m_tableGrid;
+	mutable std::map< std::string, pugi::xpath_query > m_query;  // compiled query cache
+	// ascii case insensitive hash / equal of style name
+	class NoCaseHash
+	{
+	public:
+		size_t operator()( std::string_view s ) const;
+	};
+	class NoCaseEqual
+	{
+	public:
+		bool operator()( std::string_view a, std::string_view b ) const;
+	};
+	std::map< std::string, StyleLite, std::less<> > m_style;  // transparent, find by string_view without copy
+	// key is view of StyleLite::m_name in m_style, remove before m_name change
+	std::unordered_map< std::string_view, const StyleLite * > m_styleName;
+	std::unordered_map< std::string_view, const StyleLite *, NoCaseHash, NoCaseEqual > m_styleNameNoCase;
+	std::unordered_map< std::string, int, NoCaseHash, NoCaseEqual > m_styleNameCount;  // style num of name ignore case
+	ParaFormat m_docDefault;  // w:docDefaults
+	const StyleLite * m_defaultParaStyle = nullptr;
+	mutable std::unordered_map< const StyleLite *, StyleFormat > m_styleFormat;  // memoized, cleared when any style change
 	std::map< std::string, Relationship > m_rela;
 };
 
+template< class T >
+int Document::Query( const std::string & xpath, std::vector<T> & result, const Element & ctx ) const
+{
+	pugi::xpath_node_set nodes;
+	int ret = query_nodes( xpath, ctx, nodes );
+	if( ret < 0 )
+		return ret;
+	result.clear();
+	for( const pugi::xpath_node & xnd : nodes ) {
+		Element ele( xnd.node() );
+		if( ele.GetType() == ElementTraits<T>::TYPE )
+			result.push_back( T( ele ) );
+	}
+	return (int)result.size();
+}
+
 ////////////////////////////////
 END_NS_SPD
 
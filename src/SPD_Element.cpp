@@ -16,7 +16,9 @@
 
 #include "SPD_Element.h"
 #include "SPD_Document.h"
+#include "SPD_Replace.h"
 
+#include <algorithm>
 #include <vector>
 #include <string.h> // strcmp
 
@@ -25,25 +27,122 @@ BEGIN_NS_SPD
 
 const std::string g_ElementEmptyStr = std::string("");
 
-static bool is_skipped_node( pugi::xml_node nd )
+static bool is_skipped_node( pugi::xml_node nd, TagIdE tag )
 {
 	// don't skip unknown node, only skip known unused node and nodes that already used by parent
-	if( nd.type() != pugi::node_element
-		|| strcmp( nd.name(), "w:t" ) == 0
-		|| strcmp( nd.name(), "w:pPr" ) == 0
-		|| strcmp( nd.name(), "w:rPr" ) == 0
-		|| strcmp( nd.name(), "w:tblPr" ) == 0
-		|| strcmp( nd.name(), "w:tblGrid" ) == 0
-		|| strcmp( nd.name(), "w:trPr" ) == 0
-		|| strcmp( nd.name(), "w:tcPr" ) == 0
-		|| strcmp( nd.name(), "w:sectPr" ) == 0
-		) 
+	if( nd.type() != pugi::node_element )
+		return true;
+	switch( tag )
 	{
+	case TagIdE::W_T:
+	case TagIdE::W_PPR:
+	case TagIdE::W_RPR:
+	case TagIdE::W_TBLPR:
+	case TagIdE::W_TBLGRID:
+	case TagIdE::W_TRPR:
+	case TagIdE::W_TCPR:
+	case TagIdE::W_SECTPR:
 		return true;
+	default:
+		break;
 	}
 	return false;
 }
 
+TagIdE Element::GetTagId( pugi::xml_node nd )
+{
+	if( nd.type() != pugi::node_element )
+		return TagIdE::UNKNOWN;
+	return GetTagId( nd.name() );
+}
+
+TagIdE Element::GetTagId( const char * name )
+{
+	// dispatch by first char after "w:", then at most a few compare, most common tag only check 1 or 2 char
+	if( name[0] != 'w' || name[1] != ':' )
+		return TagIdE::UNKNOWN;
+	const char * p = name + 2;
+	switch( p[0] )
+	{
+	case 'p':
+		if( p[1] == '\0' )
+			return TagIdE::W_P;
+		if( strcmp( p + 1, "Pr" ) == 0 )
+			return TagIdE::W_PPR;
+		break;
+	case 'r':
+		if( p[1] == '\0' )
+			return TagIdE::W_R;
+		if( strcmp( p + 1, "Pr" ) == 0 )
+			return TagIdE::W_RPR;
+		break;
+	case 't':
+		switch( p[1] )
+		{
+		case '\0':
+			return TagIdE::W_T;
+		case 'r':
+			if( p[2] == '\0' )
+				return TagIdE::W_TR;
+			if( strcmp( p + 2, "Pr" ) == 0 )
+				return TagIdE::W_TRPR;
+			break;
+		case 'c':
+			if( p[2] == '\0' )
+				return TagIdE::W_TC;
+			if( strcmp( p + 2, "Pr" ) == 0 )
+				return TagIdE::W_TCPR;
+			break;
+		case 'b':
+			if( p[2] != 'l' )
+				break;
+			if( p[3] == '\0' )
+				return TagIdE::W_TBL;
+			if( strcmp( p + 3, "Pr" ) == 0 )
+				return TagIdE::W_TBLPR;
+			if( strcmp( p + 3, "Grid" ) == 0 )
+				return TagIdE::W_TBLGRID;
+			break;
+		default:
+			break;
+		}
+		break;
+	case 'h':
+		if( strcmp( p, "hyperlink" ) == 0 )
+			return TagIdE::W_HYPERLINK;
+		break;
+	case 's':
+		if( strcmp( p, "sectPr" ) == 0 )
+			return TagIdE::W_SECTPR;
+		break;
+	case 'd':
+		if( strcmp( p, "drawing" ) == 0 )
+			return TagIdE::W_DRAWING;
+		break;
+	case 'o':
+		if( strcmp( p, "object" ) == 0 )
+			return TagIdE::W_OBJECT;
+		break;
+	case 'b':
+		if( strcmp( p, "bookmarkStart" ) == 0 )
+			return TagIdE::W_BOOKMARK_START;
+		if( strcmp( p, "bookmarkEnd" ) == 0 )
+			return TagIdE::W_BOOKMARK_END;
+		break;
+	case 'c':
+		if( strcmp( p, "commentRangeStart" ) == 0 )
+			return TagIdE::W_COMMENT_RANGE_START;
+		if( strcmp( p, "commentRangeEnd" ) == 0 )
+			return TagIdE::W_COMMENT_RANGE_END;
+		if( strcmp( p, "commentReference" ) == 0 )
+			return TagIdE::W_COMMENT_REFERENCE;
+		break;
+	default:
+		break;
+	}
+	return TagIdE::UNKNOWN;
+}
+
 pugi::xml_node Element::GetCreateChild( pugi::xml_node parent, const char * name )
 {
 	pugi::xml_node nd = parent.child( name );
@@ -62,6 +161,11 @@ pugi::xml_attribute Element::GetCreateAttr( pugi::xml_node nd, const char * name
 	return attr;
 }
 
+void Element::notify_change( pugi::xml_node nd, ChangeTypeE type )
+{
+	Document::on_change( nd, type );
+}
+
 Element::Element( pugi::xml_node nd ) : m_nd( nd )
 {
 	m_type = Element::GetNodeType( nd );
@@ -69,37 +173,46 @@ Element::Element( pugi::xml_node nd ) : m_nd( nd )
 
 ElementTypeE Element::GetNodeType( pugi::xml_node nd )
 {
-	ElementTypeE type = ElementTypeE::INVALID;
-	if( !nd ) {
-		type = ElementTypeE::INVALID;
-	}
-	else if( strcmp( nd.name(), "w:p" ) == 0 ) {
+	if( !nd )
+		return ElementTypeE::INVALID;
+	return get_tag_type( nd, GetTagId( nd ) );
+}
+
+ElementTypeE Element::get_tag_type( pugi::xml_node nd, TagIdE tag )
+{
+	ElementTypeE type = ElementTypeE::UNKNOWN;
+	switch( tag )
+	{
+	case TagIdE::W_P:
 		type = ElementTypeE::PARAGRAPH;
-	}
-	else if( strcmp( nd.name(), "w:r" ) == 0 ) {
-		if( !nd.child( "w:t" ).empty() || !nd.child( "w:drawing" ).empty() || !nd.child( "w:object" ).empty() ) {
-			type = ElementTypeE::RUN;
-		}
+		break;
+	case TagIdE::W_R:
+		// w:r -> w:t or w:drawing or w:object, check all child in one pass
 		// TODO (later) : other w:r, ex w:commentReference
-		else {
-			type = ElementTypeE::UNKNOWN;
+		for( pugi::xml_node cnd = nd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
+			TagIdE ctag = GetTagId( cnd );
+			if( ctag == TagIdE::W_T || ctag == TagIdE::W_DRAWING || ctag == TagIdE::W_OBJECT ) {
+				type = ElementTypeE::RUN;
+				break;
+			}
 		}
-	}
-	else if( strcmp( nd.name(), "w:hyperlink" ) == 0 ) {
+		break;
+	case TagIdE::W_HYPERLINK:
 		type = ElementTypeE::HYPERLINK;
-	}
-	else if( strcmp( nd.name(), "w:tbl" ) == 0 ) {
+		break;
+	case TagIdE::W_TBL:
 		type = ElementTypeE::TABLE;
-	}
-	else if( strcmp( nd.name(), "w:tr" ) == 0 ) {
+		break;
+	case TagIdE::W_TR:
 		type = ElementTypeE::TABLE_ROW;
-	}
-	else if( strcmp( nd.name(), "w:tc" ) == 0 ) {
+		break;
+	case TagIdE::W_TC:
 		type = ElementTypeE::TABLE_CELL;
-	}
+		break;
 	// TODO (later) : other known element
-	else {
+	default:
 		type = ElementTypeE::UNKNOWN;
+		break;
 	}
 	return type;
 }
@@ -119,10 +232,12 @@ Element Element::GetPrev() const
 {
 	if( m_type == ElementTypeE::INVALID )
 		return Element();
+	// tag id is used for both skip check and type, classify every node once
 	pugi::xml_node nd = m_nd.previous_sibling();
-	while( ! nd.empty() && is_skipped_node( nd ) )
+	TagIdE tag = TagIdE::UNKNOWN;
+	while( ! nd.empty() && is_skipped_node( nd, tag = GetTagId( nd ) ) )
 		nd = nd.previous_sibling();
-	return Element( nd );
+	return nd.empty() ? Element() : Element( nd, get_tag_type( nd, tag ) );
 }
 
 Element Element::GetNext() const
@@ -130,9 +245,10 @@ Element Element::GetNext() const
 	if( m_type == ElementTypeE::INVALID )
 		return Element();
 	pugi::xml_node nd = m_nd.next_sibling();
-	while( ! nd.empty() && is_skipped_node( nd ) )
+	TagIdE tag = TagIdE::UNKNOWN;
+	while( ! nd.empty() && is_skipped_node( nd, tag = GetTagId( nd ) ) )
 		nd = nd.next_sibling();
-	return Element( nd );
+	return nd.empty() ? Element() : Element( nd, get_tag_type( nd, tag ) );
 }
 
 Element Element::GetFirstChild() const
@@ -140,9 +256,10 @@ Element Element::GetFirstChild() const
 	if( m_type == ElementTypeE::INVALID || m_type == ElementTypeE::UNKNOWN )
 		return Element();
 	pugi::xml_node nd = m_nd.first_child();
-	while( ! nd.empty() && is_skipped_node( nd ) )
+	TagIdE tag = TagIdE::UNKNOWN;
+	while( ! nd.empty() && is_skipped_node( nd, tag = GetTagId( nd ) ) )
 		nd = nd.next_sibling();
-	return Element( nd );
+	return nd.empty() ? Element() : Element( nd, get_tag_type( nd, tag ) );
 }
 
 Element Element::GetLastChild() const
@@ -150,9 +267,10 @@ Element Element::GetLastChild() const
 	if( m_type == ElementTypeE::INVALID || m_type == ElementTypeE::UNKNOWN )
 		return Element();
 	pugi::xml_node nd = m_nd.last_child();
-	while( !nd.empty() && is_skipped_node( nd ) )
+	TagIdE tag = TagIdE::UNKNOWN;
+	while( !nd.empty() && is_skipped_node( nd, tag = GetTagId( nd ) ) )
 		nd = nd.previous_sibling();
-	return Element( nd );
+	return nd.empty() ? Element() : Element( nd, get_tag_type( nd, tag ) );
 }
 
 Element Element::GetPrev( ElementTypeE type ) const
@@ -162,7 +280,7 @@ Element Element::GetPrev( ElementTypeE type ) const
 	pugi::xml_node nd = m_nd.previous_sibling();
 	while( !nd.empty() && GetNodeType( nd ) != type )
 		nd = nd.previous_sibling();
-	return Element( nd );
+	return Element( nd, type );
 }
 
 Element Element::GetNext( ElementTypeE type ) const
@@ -172,7 +290,7 @@ Element Element::GetNext( ElementTypeE type ) const
 	pugi::xml_node nd = m_nd.next_sibling();
 	while( !nd.empty() && GetNodeType( nd ) != type )
 		nd = nd.next_sibling();
-	return Element( nd );
+	return Element( nd, type );
 }
 
 Element Element::GetChild( ElementTypeE type ) const
@@ -182,7 +300,7 @@ Element Element::GetChild( ElementTypeE type ) const
 	pugi::xml_node nd = m_nd.first_child();
 	while( !nd.empty() && GetNodeType(nd) != type )
 		nd = nd.next_sibling();
-	return Element( nd );
+	return Element( nd, type );
 }
 
 int Element::DelChild( Element & child )
@@ -197,6 +315,7 @@ int Element::DelChild( Element & child )
 
 	if( child.m_nd.parent() != m_nd )
 		return SPD_ERR_BAD_PARAM;
+	notify_change( child.m_nd, ChangeTypeE::REMOVE );
 	bool ret = m_nd.remove_child( child.m_nd );
 	return ret ? SPD_ERR_OK : SPD_ERR_INTERNAL;
 }
@@ -205,10 +324,200 @@ int Element::DelAllChild()
 {
 	if( m_type == ElementTypeE::TABLE_ROW )  // table row can not delete cell directly
 		return SPD_ERR_FORBID_DEL_TCELL;
+	for( pugi::xml_node cnd = m_nd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() )
+		notify_change( cnd, ChangeTypeE::REMOVE );
 	m_nd.remove_children();
 	return SPD_ERR_OK;
 }
 
+// w:b, w:i ... without w:val is on
+static bool read_on_off( pugi::xml_node nd )
+{
+	pugi::xml_attribute attr = nd.attribute( "w:val" );
+	if( attr.empty() )
+		return true;
+	const char * val = attr.value();
+	return !( strcmp( val, "0" ) == 0 || strcmp( val, "false" ) == 0 || strcmp( val, "off" ) == 0 );
+}
+
+int RunFormat::Load( pugi::xml_node rpr )
+{
+	int num = 0;
+	for( pugi::xml_node cnd = rpr.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
+		const char * name = cnd.name();
+		if( name[0] != 'w' || name[1] != ':' )
+			continue;
+		name += 2;
+		const char * val = cnd.attribute( "w:val" ).value();
+		uint32_t bit = 0;
+		if( strcmp( name, "b" ) == 0 ) {
+			m_bold = read_on_off( cnd );
+			bit = BOLD;
+		}
+		else if( strcmp( name, "i" ) == 0 ) {
+			m_italic = read_on_off( cnd );
+			bit = ITALIC;
+		}
+		else if( strcmp( name, "strike" ) == 0 ) {
+			m_strike = read_on_off( cnd );
+			bit = STRIKE;
+		}
+		else if( strcmp( name, "dstrike" ) == 0 ) {
+			m_dstrike = read_on_off( cnd );
+			bit = DSTRIKE;
+		}
+		else if( strcmp( name, "u" ) == 0 ) {
+			m_underline = ( strcmp( val, "none" ) == 0 ) ? "" : val;
+			bit = UNDERLINE;
+		}
+		else if( strcmp( name, "color" ) == 0 ) {
+			m_color = val;
+			bit = COLOR;
+		}
+		else if( strcmp( name, "highlight" ) == 0 ) {
+			m_highlight = ( strcmp( val, "none" ) == 0 ) ? "" : val;
+			bit = HIGHLIGHT;
+		}
+		else if( strcmp( name, "sz" ) == 0 ) {
+			m_size = atoi( val );
+			bit = SIZE;
+		}
+		else if( strcmp( name, "rFonts" ) == 0 ) {
+			// theme font is not resolved
+			pugi::xml_attribute attr = cnd.attribute( "w:ascii" );
+			if( attr.empty() )
+				continue;
+			m_font = attr.value();
+			bit = FONT;
+		}
+		else {
+			continue;
+		}
+		m_mask |= bit;
+		++num;
+	}
+	return num;
+}
+
+void RunFormat::Merge( const RunFormat & over )
+{
+	uint32_t mask = over.m_mask;
+	if( mask == 0 )
+		return;
+	if( mask & BOLD )
+		m_bold = over.m_bold;
+	if( mask & ITALIC )
+		m_italic = over.m_italic;
+	if( mask & STRIKE )
+		m_strike = over.m_strike;
+	if( mask & DSTRIKE )
+		m_dstrike = over.m_dstrike;
+	if( mask & UNDERLINE )
+		m_underline = over.m_underline;
+	if( mask & COLOR )
+		m_color = over.m_color;
+	if( mask & HIGHLIGHT )
+		m_highlight = over.m_highlight;
+	if( mask & SIZE )
+		m_size = over.m_size;
+	if( mask & FONT )
+		m_font = over.m_font;
+	m_mask |= mask;
+	return;
+}
+
+void RunFormat::Toggle( const RunFormat & over )
+{
+	bool bold = m_bold, italic = m_italic, strike = m_strike, dstrike = m_dstrike;
+	Merge( over );
+	if( over.m_mask & BOLD )
+		m_bold = ( bold != over.m_bold );
+	if( over.m_mask & ITALIC )
+		m_italic = ( italic != over.m_italic );
+	if( over.m_mask & STRIKE )
+		m_strike = ( strike != over.m_strike );
+	if( over.m_mask & DSTRIKE )
+		m_dstrike = ( dstrike != over.m_dstrike );
+	return;
+}
+
+int ParaFormat::Load( pugi::xml_node ppr )
+{
+	int num = 0;
+	pugi::xml_node nd = ppr.child( "w:jc" );
+	if( !nd.empty() ) {
+		m_align = nd.attribute( "w:val" ).value();
+		m_mask |= ALIGN;
+		++num;
+	}
+	nd = ppr.child( "w:spacing" );
+	if( !nd.empty() ) {
+		pugi::xml_attribute attr = nd.attribute( "w:before" );
+		if( !attr.empty() ) {
+			m_spaceBefore = attr.as_int();
+			m_mask |= SPACE_BEFORE;
+			++num;
+		}
+		attr = nd.attribute( "w:after" );
+		if( !attr.empty() ) {
+			m_spaceAfter = attr.as_int();
+			m_mask |= SPACE_AFTER;
+			++num;
+		}
+	}
+	nd = ppr.child( "w:ind" );
+	if( !nd.empty() ) {
+		pugi::xml_attribute attr = nd.attribute( "w:left" );
+		if( attr.empty() )
+			attr = nd.attribute( "w:start" );
+		if( !attr.empty() ) {
+			m_indLeft = attr.as_int();
+			m_mask |= IND_LEFT;
+			++num;
+		}
+		if( !( attr = nd.attribute( "w:firstLine" ) ).empty() ) {
+			m_indFirst = attr.as_int();
+			m_mask |= IND_FIRST;
+			++num;
+		}
+		else if( !( attr = nd.attribute( "w:hanging" ) ).empty() ) {
+			m_indFirst = -attr.as_int();
+			m_mask |= IND_FIRST;
+			++num;
+		}
+	}
+	nd = ppr.child( "w:numPr" );
+	if( !nd.empty() ) {
+		m_numId = nd.child( "w:numId" ).attribute( "w:val" ).value();
+		m_numLevel = nd.child( "w:ilvl" ).attribute( "w:val" ).as_int();
+		m_mask |= NUMBER;
+		++num;
+	}
+	return num;
+}
+
+void ParaFormat::Merge( const ParaFormat & over )
+{
+	uint32_t mask = over.m_mask;
+	if( mask & ALIGN )
+		m_align = over.m_align;
+	if( mask & SPACE_BEFORE )
+		m_spaceBefore = over.m_spaceBefore;
+	if( mask & SPACE_AFTER )
+		m_spaceAfter = over.m_spaceAfter;
+	if( mask & IND_LEFT )
+		m_indLeft = over.m_indLeft;
+	if( mask & IND_FIRST )
+		m_indFirst = over.m_indFirst;
+	if( mask & NUMBER ) {
+		m_numId = over.m_numId;
+		m_numLevel = over.m_numLevel;
+	}
+	m_mask |= mask;
+	m_run.Merge( over.m_run );
+	return;
+}
+
 const char * Paragraph::GetStyleId() const
 {
 	pugi::xml_attribute attr = m_nd.child( "w:pPr" ).child( "w:pStyle" ).attribute( "w:val" );
@@ -220,6 +529,15 @@ const char * Paragraph::GetStyleName( const Document & doc ) const
 	return doc.GetStyleName( GetStyleId() );
 }
 
+ParaFormat Paragraph::GetEffectiveFormat( const Document & doc ) const
+{
+	ParaFormat fmt = doc.GetStyleFormat( GetStyleId() );
+	ParaFormat direct;
+	if( direct.Load( m_nd.child( "w:pPr" ) ) > 0 )
+		fmt.Merge( direct );
+	return fmt;
+}
+
 const char * Paragraph::GetNumId() const
 {
 	pugi::xml_attribute attr = m_nd.child( "w:pPr" ).child( "w:numPr" ).child( "w:numId" ).attribute( "w:val" );
@@ -249,6 +567,7 @@ int Paragraph::SetStyleId( const char * id )
 		}
 		attr.set_value( id );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -274,6 +593,7 @@ int Paragraph::SetNumId( const char * id )
 		}
 		Element::GetCreateAttr( nd3, "w:val" ).set_value( id );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -295,36 +615,131 @@ int Paragraph::SetNumLevel( int level )
 		std::string lstr = std::to_string( level );
 		Element::GetCreateAttr( nd3, "w:val" ).set_value( lstr.c_str() );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
 std::string Paragraph::GetText() const
 {
 	std::string text;
+	GetText( text );
+	return text;
+}
+
+int Paragraph::GetText( std::string & out ) const
+{
+	size_t len = out.size();
 	for( pugi::xml_node cnd = m_nd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
-		if( strcmp( cnd.name(), "w:r" ) == 0 ) {
-			text.append( cnd.child( "w:t" ).text().get() );
+		TagIdE tag = Element::GetTagId( cnd );
+		if( tag == TagIdE::W_R ) {
+			out.append( cnd.child( "w:t" ).text().get() );
 		}
-		else if( strcmp( cnd.name(), "w:hyperlink" ) == 0 ) {
+		else if( tag == TagIdE::W_HYPERLINK ) {
 			for( pugi::xml_node cnd2 = cnd.first_child(); !cnd2.empty(); cnd2 = cnd2.next_sibling() ) {
-				if( strcmp( cnd2.name(), "w:r" ) == 0 ) {
-					text.append( cnd2.child( "w:t" ).text().get() );
+				if( Element::GetTagId( cnd2 ) == TagIdE::W_R ) {
+					out.append( cnd2.child( "w:t" ).text().get() );
 				}
 			}
 		}
 	}
-	return text;
+	return (int)( out.size() - len );
+}
+
+int Paragraph::Replace( const TextReplacer & rep )
+{
+	// every w:t of run in order, text is concat of all piece
+	struct Piece
+	{
+		pugi::xml_node m_t;
+		size_t m_begin;
+		std::string m_text;
+		bool m_dirty;
+	};
+	std::vector<Piece> pieces;
+	std::string text;
+	auto add_run = [&]( pugi::xml_node rnd ) {
+		for( pugi::xml_node tnd = rnd.child( "w:t" ); !tnd.empty(); tnd = tnd.next_sibling( "w:t" ) ) {
+			const char * str = tnd.text().get();
+			pieces.push_back( Piece{ tnd, text.size(), str, false } );
+			text.append( pieces.back().m_text );
+		}
+	};
+	for( pugi::xml_node cnd = m_nd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
+		TagIdE tag = Element::GetTagId( cnd );
+		if( tag == TagIdE::W_R )
+			add_run( cnd );
+		else if( tag == TagIdE::W_HYPERLINK ) {
+			for( pugi::xml_node cnd2 = cnd.child( "w:r" ); !cnd2.empty(); cnd2 = cnd2.next_sibling( "w:r" ) )
+				add_run( cnd2 );
+		}
+	}
+	std::vector<TextReplacer::Match> matches;
+	int num = rep.FindAll( text, matches );
+	if( num <= 0 )
+		return 0;
+
+	// from last match, so offset of piece before it is not changed
+	// piece of pos is the last one begin <= pos, empty piece is skipped by the non-empty one with same begin
+	auto find_piece = [&]( size_t pos ) {
+		auto it = std::upper_bound( pieces.begin(), pieces.end(), pos, []( size_t p, const Piece & pc ) { return p < pc.m_begin; } );
+		return (size_t)( it - pieces.begin() ) - 1;
+	};
+	for( auto mit = matches.rbegin(); mit != matches.rend(); ++mit ) {
+		size_t pos = mit->m_pos, end = mit->m_pos + mit->m_len;
+		size_t first = find_piece( pos );
+		size_t last = find_piece( end - 1 );
+		const std::string & to = rep.GetReplace( mit->m_idx );
+		Piece & pf = pieces[first];
+		if( first == last ) {
+			pf.m_text.replace( pos - pf.m_begin, mit->m_len, to );
+		}
+		else {
+			pf.m_text.replace( pos - pf.m_begin, std::string::npos, to );
+			for( size_t i = first + 1; i < last; ++i ) {
+				pieces[i].m_text.clear();
+				pieces[i].m_dirty = true;
+			}
+			pieces[last].m_text.erase( 0, end - pieces[last].m_begin );
+			pieces[last].m_dirty = true;
+		}
+		pf.m_dirty = true;
+	}
+
+	for( Piece & pc : pieces ) {
+		if( !pc.m_dirty )
+			continue;
+		pugi::xml_node rnd = pc.m_t.parent();
+		if( pc.m_text.empty() ) {
+			rnd.remove_child( pc.m_t );
+			// run only with property is removed
+			pugi::xml_node cnd = rnd.first_child();
+			if( Element::GetTagId( cnd ) == TagIdE::W_RPR )
+				cnd = cnd.next_sibling();
+			if( cnd.empty() ) {
+				notify_change( rnd, ChangeTypeE::REMOVE );
+				rnd.parent().remove_child( rnd );
+			}
+			continue;
+		}
+		if( pc.m_text.front() == ' ' || pc.m_text.back() == ' ' )
+			Element::GetCreateAttr( pc.m_t, "xml:space" ).set_value( "preserve" );
+		pc.m_t.text().set( pc.m_text.data(), pc.m_text.size() );
+	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
+	return num;
 }
 
 Run Paragraph::AddChildRun( bool add_back )
 {
 	pugi::xml_node nd = add_back ? m_nd.append_child( "w:r" ) : m_nd.prepend_child( "w:r" );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Run( Element( nd ) );
 }
 
 Hyperlink Paragraph::AddChildHyperlink( bool add_back )
 {
 	pugi::xml_node nd = add_back ? m_nd.append_child( "w:hyperlink" ) : m_nd.prepend_child( "w:hyperlink" );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Hyperlink( Element( nd ) );
 }
 
@@ -332,6 +747,7 @@ Paragraph Paragraph::AddSiblingParagraph( bool add_next )
 {
 	pugi::xml_node nd = add_next ? m_nd.parent().insert_child_after( "w:p", m_nd )
 		: m_nd.parent().insert_child_before( "w:p", m_nd );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Paragraph( Element( nd ) );
 }
 
@@ -341,6 +757,7 @@ Table Paragraph::AddSiblingTable( bool add_next )
 		: m_nd.parent().insert_child_before( "w:tbl", m_nd );
 	Table tbl = Element( nd );
 	tbl.Reset();
+	notify_change( nd, ChangeTypeE::INSERT );
 	return tbl;
 }
 
@@ -389,12 +806,19 @@ const std::string & Hyperlink::GetRelaTarget( const Document & doc ) const
 std::string Hyperlink::GetText() const
 {
 	std::string text;
+	GetText( text );
+	return text;
+}
+
+int Hyperlink::GetText( std::string & out ) const
+{
+	size_t len = out.size();
 	for( pugi::xml_node cnd = m_nd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
-		if( strcmp( cnd.name(), "w:r" ) == 0 ) {
-			text.append( cnd.child( "w:t" ).text().get() );
+		if( Element::GetTagId( cnd ) == TagIdE::W_R ) {
+			out.append( cnd.child( "w:t" ).text().get() );
 		}
 	}
-	return text;
+	return (int)( out.size() - len );
 }
 
 int Hyperlink::SetAnchor( const char * anchor )
@@ -409,6 +833,7 @@ int Hyperlink::SetAnchor( const char * anchor )
 			attr = m_nd.append_attribute( "w:anchor" );
 		attr.set_value( anchor );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -424,12 +849,14 @@ int Hyperlink::SetRelaId( const char * id )
 			attr = m_nd.append_attribute( "r:id" );
 		attr.set_value( id );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
 Run Hyperlink::AddChildRun( bool add_back )
 {
 	pugi::xml_node nd = add_back ? m_nd.append_child( "w:r" ) : m_nd.prepend_child( "w:r" );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Run( Element( nd ) );
 }
 
@@ -437,6 +864,7 @@ Hyperlink Hyperlink::AddSiblingHyperlink( bool add_next )
 {
 	pugi::xml_node nd = add_next ? m_nd.parent().insert_child_after( "w:hyperlink", m_nd )
 		: m_nd.parent().insert_child_before( "w:hyperlink", m_nd );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Hyperlink( Element( nd ) );
 }
 
@@ -444,6 +872,7 @@ Run Hyperlink::AddSiblingRun( bool add_next )
 {
 	pugi::xml_node nd = add_next ? m_nd.parent().insert_child_after( "w:r", m_nd )
 		: m_nd.parent().insert_child_before( "w:r", m_nd );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Run( Element( nd ) );
 }
 
@@ -504,9 +933,33 @@ bool Run::GetDoubleStrike() const
 
 std::string Run::GetText() const
 {
-	std::string text;
-	text.append( m_nd.child( "w:t" ).text().get() );
-	return text;
+	return std::string( m_nd.child( "w:t" ).text().get() );
+}
+
+int Run::GetText( std::string & out ) const
+{
+	size_t len = out.size();
+	out.append( m_nd.child( "w:t" ).text().get() );
+	return (int)( out.size() - len );
+}
+
+RunFormat Run::GetEffectiveFormat( const Document & doc ) const
+{
+	// run may be in hyperlink or other inline container
+	pugi::xml_node pnd = m_nd.parent();
+	while( !pnd.empty() && Element::GetTagId( pnd ) != TagIdE::W_P )
+		pnd = pnd.parent();
+	const char * pstyle = pnd.child( "w:pPr" ).child( "w:pStyle" ).attribute( "w:val" ).value();
+	RunFormat fmt = doc.GetStyleFormat( pstyle ).m_run;
+	pugi::xml_node rpr = m_nd.child( "w:rPr" );
+	const char * rstyle = rpr.child( "w:rStyle" ).attribute( "w:val" ).value();
+	// toggle property of character style flip the paragraph style, direct format overwrite
+	if( rstyle[0] != '\0' )
+		fmt.Toggle( doc.GetCharStyleFormat( rstyle ) );
+	RunFormat direct;
+	if( direct.Load( rpr ) > 0 )
+		fmt.Merge( direct );
+	return fmt;
 }
 
 int Run::SetColor( const char * color )
@@ -526,6 +979,7 @@ int Run::SetColor( const char * color )
 		pugi::xml_node nd2 = Element::GetCreateChild( nd, "w:color" );
 		Element::GetCreateAttr( nd2, "w:val" ).set_value( color );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -546,6 +1000,7 @@ int Run::SetHighline( const char * color )
 		pugi::xml_node nd2 = Element::GetCreateChild( nd, "w:highlight" );
 		Element::GetCreateAttr( nd2, "w:val" ).set_value( color );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -567,6 +1022,7 @@ int Run::SetBold( bool bold )
 				m_nd.remove_child( nd );
 		}
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -588,6 +1044,7 @@ int Run::SetItalic( bool italic )
 				m_nd.remove_child( nd );
 		}
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -608,6 +1065,7 @@ int Run::SetUnderline( const char * underline )
 		pugi::xml_node nd2 = Element::GetCreateChild( nd, "w:u" );
 		Element::GetCreateAttr( nd2, "w:val" ).set_value( underline );
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -630,6 +1088,7 @@ int Run::SetStrike( bool strike )
 				m_nd.remove_child( nd );
 		}
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -652,6 +1111,7 @@ int Run::SetDoubleStrike( bool dstrike )
 				m_nd.remove_child( nd );
 		}
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -660,6 +1120,8 @@ void Run::SetText( const char * text )
 	m_nd.remove_child( "w:drawing" );
 	m_nd.remove_child( "w:object" );
 	Element::GetCreateChild( m_nd, "w:t" ).text().set( text );
+	update_type();
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return;
 }
 
@@ -694,6 +1156,8 @@ int Run::SetPic( const char * id )
 	nd = Element::GetCreateChild( nd, "pic:blipFill" );
 	nd = Element::GetCreateChild( nd, "a:blip" );
 	Element::GetCreateAttr( nd, "r:embed" ).set_value( id );
+	update_type();
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -763,6 +1227,8 @@ int Run::SetObject( const char * objid, const char * progid, const char * imgid
 	nd2 = Element::GetCreateChild( nd, "v:shape" );
 	nd2 = Element::GetCreateChild( nd2, "v:imagedata" );
 	Element::GetCreateAttr( nd2, "r:id" ).set_value( imgid );
+	update_type();
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -792,6 +1258,7 @@ Hyperlink Run::AddSiblingHyperlink( bool add_next )
 {
 	pugi::xml_node nd = add_next ? m_nd.parent().insert_child_after( "w:hyperlink", m_nd )
 		: m_nd.parent().insert_child_before( "w:hyperlink", m_nd );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Hyperlink( Element( nd ) );
 }
 
@@ -799,6 +1266,7 @@ Run Run::AddSiblingRun( bool add_next )
 {
 	pugi::xml_node nd = add_next ? m_nd.parent().insert_child_after( "w:r", m_nd )
 		: m_nd.parent().insert_child_before( "w:r", m_nd );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Run( Element( nd ) );
 }
 
@@ -851,103 +1319,149 @@ int Table::GetColWidth( int idx ) const
 
 int Table::AddCol( int index )
 {
-	int colnum = GetColNum();
-	if( index < 0 || index > colnum )
-		return SPD_ERR_BAD_PARAM;
+	return AddCols( index, 1 );
+}
 
-	// update column size
-	std::vector<int> widths = GetColWidth();
-	widths.insert( widths.begin() + index, 0 );
-	if( index == 0 ) {
-		int size = widths[1] / 2;
-		widths[0] = widths[1] = size < 100 ? 100 : size;
+int Table::DelCol( int index )
+{
+	return DelCols( index, 1 );
+}
+
+// gridSpan of w:tc, 1 means remove gridSpan
+static void set_grid_span( pugi::xml_node tc, int span )
+{
+	pugi::xml_node tcpr = tc.child( "w:tcPr" );
+	if( tcpr.empty() )
+		tcpr = tc.prepend_child( "w:tcPr" );
+	if( span <= 1 ) {
+		tcpr.remove_child( "w:gridSpan" );
+		return;
 	}
-	else if( index == colnum ) {
-		int size = widths[index - 1] / 2;
-		widths[index] = widths[index - 1] = size < 100 ? 100 : size;
+	pugi::xml_node pnd = Element::GetCreateChild( tcpr, "w:gridSpan" );
+	Element::GetCreateAttr( pnd, "w:val" ).set_value( span );
+	return;
+}
+
+int Table::AddCols( int index, int count, const std::vector<int> & widths )
+{
+	int colnum = GetColNum();
+	if( index < 0 || index > colnum || count < 1 )
+		return SPD_ERR_BAD_PARAM;
+	if( !widths.empty() && (int)widths.size() != count )
+		return SPD_ERR_BAD_PARAM;
+	for( auto & w : widths ) {
+		if( w < 100 )
+			return SPD_ERR_BAD_PARAM;
 	}
-	else {
-		int size1 = widths[index - 1] / 3 * 2;
-		int size3 = widths[index + 1] / 3 * 2;
-		int size2 = size1 / 2 + size3 / 2;
-		widths[index - 1] = size1 < 100 ? 100 : size1;
-		widths[index] = size2 < 100 ? 100 : size2;
-		widths[index + 1] = size3 < 100 ? 100 : size3;
-	}
-	SetColWidth( widths );
-
-	// add cell to every row
-	Element ele;
-	for( ele = GetFirstChild(); ele.IsValid(); ele = ele.GetNext() )
-	{
-		TRow row = TRow( ele );
-		if( index == 0 ) {
-			m_nd.prepend_child( "w:tc" );
+
+	// update column size in one pass of w:gridCol
+	// default width : new columns share 1/2 of side neighbor, or 1/3 of both neighbor if insert in middle
+	pugi::xml_node grid = GetCreateChild( m_nd, "w:tblGrid" );
+	pugi::xml_node prev, next;
+	int i = 0;
+	for( next = grid.child( "w:gridCol" ); i < index && !next.empty(); ++i, next = next.next_sibling( "w:gridCol" ) )
+		prev = next;
+	int size = 8100 / count;
+	if( !prev.empty() && !next.empty() ) {
+		int size1 = prev.attribute( "w:w" ).as_int() / 3;
+		int size3 = next.attribute( "w:w" ).as_int() / 3;
+		size = ( size1 + size3 ) / count;
+		prev.attribute( "w:w" ) = ( size1 * 2 < 100 ) ? 100 : size1 * 2;
+		next.attribute( "w:w" ) = ( size3 * 2 < 100 ) ? 100 : size3 * 2;
+	}
+	else if( !prev.empty() || !next.empty() ) {
+		pugi::xml_node side = prev.empty() ? next : prev;
+		size = side.attribute( "w:w" ).as_int() / ( count + 1 );
+		side.attribute( "w:w" ) = size < 100 ? 100 : size;
+	}
+	for( i = 0; i < count; ++i ) {
+		pugi::xml_node cnd = next.empty() ? grid.append_child( "w:gridCol" ) : grid.insert_child_before( "w:gridCol", next );
+		int w = widths.empty() ? size : widths[i];
+		cnd.append_attribute( "w:w" ) = w < 100 ? 100 : w;
+	}
+
+	// add cell to every row in one pass of its cells
+	for( pugi::xml_node rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ) ) {
+		int col = 0;
+		pugi::xml_node cnd, last;
+		for( cnd = rnd.child( "w:tc" ); !cnd.empty(); cnd = cnd.next_sibling( "w:tc" ) ) {
+			int span = TCell( Element( cnd, ElementTypeE::TABLE_CELL ) ).GetSpanNum();
+			if( index < col + span )
+				break;
+			col += span;
+			last = cnd;
 		}
-		else if( index == colnum ) {
-			m_nd.append_child( "w:tc" );
+		if( !cnd.empty() && index > col ) {
+			// insert inside span, the spanned cell cover new columns too
+			set_grid_span( cnd, TCell( Element( cnd, ElementTypeE::TABLE_CELL ) ).GetSpanNum() + count );
+			continue;
 		}
-		else {
-			int firstcol = -1;
-			int span = -1;
-			TCell cell = row.GetCell( index, firstcol, span );
-			if( index == firstcol ) {
-				row.m_nd.insert_child_before( "w:tc", cell.m_nd );
-			}
-			else if( index == firstcol + span ) {
-				row.m_nd.insert_child_after( "w:tc", cell.m_nd );
-			}
-			else {
-				// set current node gridSpan, merge other cell to this
-				pugi::xml_node pnd = cell.m_nd.child( "w:tcPr" ).child( "w:gridSpan" );
-				if( pnd.empty() ) {
-					pnd = cell.m_nd.child( "w:tcPr" ).append_child( "w:gridSpan" );
-				}
-				pnd.attribute( "w:val" ) = span + 1;
-			}
+		if( cnd.empty() && index > col )
+			continue;  // short row, not reach index
+		for( i = 0; i < count; ++i ) {
+			pugi::xml_node nnd;
+			if( !cnd.empty() )
+				nnd = rnd.insert_child_before( "w:tc", cnd );
+			else if( !last.empty() )
+				nnd = rnd.insert_child_after( "w:tc", last );
+			else
+				nnd = rnd.append_child( "w:tc" );
+			nnd.append_child( "w:tcPr" );
+			nnd.append_child( "w:p" );
+			last = nnd;
 		}
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
-int Table::DelCol( int index )
+int Table::DelCols( int index, int count )
 {
-	// only one column can not delete
+	// at least one column left
 	int colnum = GetColNum();
-	if( index < 0 || index >= colnum || colnum == 1 )
+	if( index < 0 || count < 1 || index + count > colnum || count == colnum )
 		return SPD_ERR_BAD_PARAM;
 
-	// update column size
-	std::vector<int> widths = GetColWidth();
-	if( index == 0 ) {
-		widths[1] += widths[0];
-	}
-	else{
-		widths[index - 1] += widths[index];
-	}
-	widths.erase( widths.begin() + index );
-	SetColWidth( widths );
-
-	// del cell in every row
-	Element ele;
-	for( ele = GetFirstChild(); ele.IsValid(); ele = ele.GetNext() )
-	{
-		TRow row = TRow( ele );
-		int firstcol = -1;
-		int span = -1;
-		TCell cell = row.GetCell( index, firstcol, span );
-		if( span == 1 ) {
-			row.m_nd.remove_child( cell.m_nd );
-		}
-		else if( span == 2 ) {
-			cell.m_nd.child( "w:tcPr" ).remove_child( "w:gridSpan" );
-		}
-		else {
-			// set current node gridSpan, merge other cell to this
-			pugi::xml_node pnd = cell.m_nd.child( "w:tcPr" ).child( "w:gridSpan" );
-			pnd.attribute( "w:val" ) = span - 1;
+	// update column size in one pass, removed width is added to left column ( right if no left )
+	pugi::xml_node grid = m_nd.child( "w:tblGrid" );
+	pugi::xml_node prev, cnd = grid.child( "w:gridCol" );
+	int i = 0;
+	for( ; i < index; ++i, cnd = cnd.next_sibling( "w:gridCol" ) )
+		prev = cnd;
+	int removed = 0;
+	for( i = 0; i < count; ++i ) {
+		pugi::xml_node next = cnd.next_sibling( "w:gridCol" );
+		removed += cnd.attribute( "w:w" ).as_int();
+		grid.remove_child( cnd );
+		cnd = next;
+	}
+	pugi::xml_node side = prev.empty() ? cnd : prev;
+	side.attribute( "w:w" ) = side.attribute( "w:w" ).as_int() + removed;
+
+	// del or shrink cell in every row in one pass of its cells
+	int last = index + count;
+	for( pugi::xml_node rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ) ) {
+		int col = 0;
+		pugi::xml_node next;
+		for( cnd = rnd.child( "w:tc" ); !cnd.empty() && col < last; cnd = next ) {
+			next = cnd.next_sibling( "w:tc" );
+			int span = TCell( Element( cnd, ElementTypeE::TABLE_CELL ) ).GetSpanNum();
+			int first = col;
+			col += span;
+			// overlap of [first, first + span) and [index, last)
+			int overlap = std::min( first + span, last ) - std::max( first, index );
+			if( overlap <= 0 )
+				continue;
+			if( overlap >= span ) {
+				notify_change( cnd, ChangeTypeE::REMOVE );
+				rnd.remove_child( cnd );
+			}
+			else {
+				set_grid_span( cnd, span - overlap );
+			}
 		}
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -970,31 +1484,48 @@ int Table::SetColWidth( const std::vector<int> widths )
 		SPD_PR_DEBUG( "width num not match col num" );
 	}
 
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
-int Table::Reset( int row, int col )
+void Table::set_grid_col( int col )
 {
-	if( row < 1 || col < 1 || col > 80 )
-		return SPD_ERR_BAD_PARAM;
-	int i = 0;
-	pugi::xml_node pnd;
-	pnd = m_nd.child( "w:tblGrid" );
+	pugi::xml_node pnd = m_nd.child( "w:tblGrid" );
 	if( pnd.empty() ) {
 		pnd = m_nd.prepend_child( "w:tblGrid" );
 	}
 	pnd.remove_children();
-	for( i = 0; i < col; ++i ) {
+	for( int i = 0; i < col; ++i ) {
 		pugi::xml_node cnd = pnd.append_child( "w:gridCol" );
-		cnd.attribute( "w:w" ) = 8100 / col;
+		cnd.attribute( "w:w" ) = 8100 / col < 100 ? 100 : 8100 / col;
 	}
+	return;
+}
+
+void Table::reset_grid( int col )
+{
+	pugi::xml_node pnd;
+	set_grid_col( col );
 
 	pnd = m_nd.child( "w:tblPr" );
 	if( pnd.empty() ) {
 		pnd = m_nd.prepend_child( "w:tblPr" );
 	}
-	
-	m_nd.remove_child( "w:tr" );
+
+	for( pugi::xml_node rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = m_nd.child( "w:tr" ) ) {
+		notify_change( rnd, ChangeTypeE::REMOVE );
+		m_nd.remove_child( rnd );
+	}
+	return;
+}
+
+int Table::Reset( int row, int col )
+{
+	if( row < 1 || col < 1 || col > 80 )
+		return SPD_ERR_BAD_PARAM;
+	int i = 0;
+	pugi::xml_node pnd;
+	reset_grid( col );
 	for( i = 0; i < row; ++i ) {
 		pnd = m_nd.append_child( "w:tr" );
 		pnd.append_child( "w:trPr" );
@@ -1004,6 +1535,7 @@ int Table::Reset( int row, int col )
 			cnd.append_child( "w:tcPr" );
 		}
 	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -1020,94 +1552,652 @@ TRow Table::AddChildTRow( bool add_back )
 	return TRow( Element() );  // never come here
 }
 
-int Table::DelRow( Element & row )
+template< class S >
+int Table::fill_rows( const std::vector< std::vector<S> > & cells, const std::vector<std::string> & colStyle )
 {
-	if( row.m_nd.parent() != m_nd )
+	size_t col = 0;
+	for( const auto & row : cells ) {
+		if( col < row.size() )
+			col = row.size();
+	}
+	if( cells.empty() || col < 1 || col > 80 )
 		return SPD_ERR_BAD_PARAM;
+	reset_grid( (int)col );
+
+	// append only, every node is new, no child lookup
+	for( const auto & row : cells ) {
+		pugi::xml_node rnd = m_nd.append_child( "w:tr" );
+		rnd.append_child( "w:trPr" );
+		for( size_t i = 0; i < col; ++i ) {
+			pugi::xml_node cnd = rnd.append_child( "w:tc" );
+			cnd.append_child( "w:tcPr" );
+			pugi::xml_node pnd = cnd.append_child( "w:p" );
+			if( i < colStyle.size() && !colStyle[i].empty() )
+				pnd.append_child( "w:pPr" ).append_child( "w:pStyle" ).append_attribute( "w:val" ).set_value( colStyle[i].c_str() );
+			if( i >= row.size() || row[i].empty() )
+				continue;
+			const S & text = row[i];
+			pugi::xml_node tnd = pnd.append_child( "w:r" ).append_child( "w:t" );
+			if( text.front() == ' ' || text.back() == ' ' )
+				tnd.append_attribute( "xml:space" ).set_value( "preserve" );
+			tnd.text().set( text.data(), text.size() );
+		}
+	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
+	return SPD_ERR_OK;
+}
 
-	// adjust prev or next cell if VMerge, nothing to do if not VMerge
-	TRow curr_row( row );
-	Element child = curr_row.GetFirstChild();
-	int curr_col = 0;
-	while( child.IsValid() ) {
-		TCell cell = child;
-		int span = cell.GetSpanNum();
-		VMergeTypeE vmt = cell.GetVMergeType();
-		if( vmt == VMergeTypeE::START ) {
-			TRow next_row1 = curr_row.GetNext();
-			if( next_row1.IsValid() ) {
-				TCell next_cell1 = next_row1.GetCell( curr_col );
-				VMergeTypeE type = next_cell1.GetVMergeType();
-				if( type == VMergeTypeE::CONT ) {
-					TRow next_row2 = next_row1.GetNext();
-					if( next_row2.IsValid() ) {
-						TCell next_cell2 = next_row2.GetCell( curr_col );
-						if( next_cell2.GetVMergeType() != VMergeTypeE::CONT ) {
-							// next next cell is not a continue cell, so next cell is the last cell, change to normal cell
-							next_cell1.set_vmerge_type( VMergeTypeE::NONE );
-						}
-						else {
-							// next next cell is a continue cell, change to start cell
-							next_cell1.set_vmerge_type( VMergeTypeE::START );
-						}
-					}
-					else {
-						// no next next cell, so next cell is the last cell, change to normal cell
-						next_cell1.set_vmerge_type( VMergeTypeE::NONE );
-					}
+int Table::Fill( const std::vector< std::vector<std::string> > & cells, const std::vector<std::string> & colStyle )
+{
+	return fill_rows( cells, colStyle );
+}
+
+int Table::Fill( const std::vector< std::vector<std::string_view> > & cells, const std::vector<std::string> & colStyle )
+{
+	return fill_rows( cells, colStyle );
+}
+
+// text of cell piece by piece, used by TCell::GetText()
+template< class F >
+static void for_each_cell_text( pugi::xml_node tc, F func )
+{
+	bool is_first = true;
+	for( pugi::xml_node pnd = tc.first_child(); !pnd.empty(); pnd = pnd.next_sibling() ) {
+		if( Element::GetTagId( pnd ) != TagIdE::W_P )
+			continue;
+		if( !is_first )
+			func( "\n", 1 );
+		is_first = false;
+		for( pugi::xml_node cnd = pnd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
+			TagIdE tag = Element::GetTagId( cnd );
+			if( tag == TagIdE::W_HYPERLINK ) {
+				for( pugi::xml_node cnd2 = cnd.first_child(); !cnd2.empty(); cnd2 = cnd2.next_sibling() ) {
+					if( Element::GetTagId( cnd2 ) != TagIdE::W_R )
+						continue;
+					const char * text = cnd2.child( "w:t" ).text().get();
+					func( text, strlen( text ) );
 				}
-				else {
-					// start cell's next cell is not cont cell, should not happend
+			}
+			else if( tag == TagIdE::W_R ) {
+				const char * text = cnd.child( "w:t" ).text().get();
+				func( text, strlen( text ) );
+			}
+		}
+	}
+	return;
+}
+
+// small buffer before TextSink, keep first error
+class BufferSink
+{
+public:
+	explicit BufferSink( TextSink & sink ) : m_sink( sink ) { }
+	void Put( char c ) { if( m_len == sizeof(m_buf) ) Flush(); m_buf[m_len++] = c; }
+	void Put( const char * data, size_t len ) {
+		if( m_len + len > sizeof(m_buf) )
+			Flush();
+		if( len >= sizeof(m_buf) ) {
+			if( m_err >= 0 )
+				m_err = m_sink.Write( data, len );
+			return;
+		}
+		memcpy( m_buf + m_len, data, len );
+		m_len += len;
+	}
+	int Flush() {
+		if( m_len > 0 && m_err >= 0 )
+			m_err = m_sink.Write( m_buf, m_len );
+		m_len = 0;
+		return m_err < 0 ? m_err : SPD_ERR_OK;
+	}
+private:
+	TextSink & m_sink;
+	char m_buf[8192];
+	size_t m_len = 0;
+	int m_err = 0;
+};
+
+static void write_field( BufferSink & out, pugi::xml_node tc, const DelimitedOption & opt )
+{
+	bool quote = false;
+	const char special[] = { opt.m_delim, opt.m_quote, '\n', '\r' };
+	for_each_cell_text( tc, [&]( const char * text, size_t len ) {
+		for( size_t i = 0; !quote && i < len; ++i )
+			quote = memchr( special, text[i], sizeof(special) ) != nullptr;
+	} );
+	if( !quote ) {
+		for_each_cell_text( tc, [&]( const char * text, size_t len ) { out.Put( text, len ); } );
+		return;
+	}
+	out.Put( opt.m_quote );
+	for_each_cell_text( tc, [&]( const char * text, size_t len ) {
+		const char * end = text + len;
+		const char * q;
+		while( ( q = (const char *)memchr( text, opt.m_quote, end - text ) ) != nullptr ) {
+			out.Put( text, q - text + 1 );
+			out.Put( opt.m_quote );
+			text = q + 1;
+		}
+		out.Put( text, end - text );
+	} );
+	out.Put( opt.m_quote );
+	return;
+}
+
+int Table::ExportDelimited( TextSink & writer, const DelimitedOption & opt ) const
+{
+	if( GetType() != ElementTypeE::TABLE )
+		return SPD_ERR_BAD_PARAM;
+	BufferSink out( writer );
+	size_t line_end_len = strlen( opt.m_lineEnd );
+	int colnum = GetColNum();
+	std::vector<pugi::xml_node> vowner( colnum > 0 ? colnum : 0 );  // top cell of each grid col in previous row
+	for( pugi::xml_node rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ) ) {
+		int col = 0;
+		for( pugi::xml_node cnd = rnd.child( "w:tc" ); !cnd.empty(); cnd = cnd.next_sibling( "w:tc" ) ) {
+			TCell cell = TCell( Element( cnd, ElementTypeE::TABLE_CELL ) );
+			int span = cell.GetSpanNum();
+			if( span < 1 )
+				span = 1;
+			if( col + span > (int)vowner.size() )
+				vowner.resize( col + span );
+			pugi::xml_node owner = cnd;
+			bool covered = false;
+			if( cell.GetVMergeType() == VMergeTypeE::CONT && !vowner[col].empty() ) {
+				owner = vowner[col];
+				covered = true;
+			}
+			for( int i = 0; i < span; ++i, ++col ) {
+				vowner[col] = owner;
+				if( col > 0 )
+					out.Put( opt.m_delim );
+				if( opt.m_merged == MergedCellE::REPEAT || ( i == 0 && !covered ) )
+					write_field( out, owner, opt );
+			}
+		}
+		for( ; col < colnum; ++col ) {
+			vowner[col] = pugi::xml_node();
+			if( col > 0 )
+				out.Put( opt.m_delim );
+		}
+		out.Put( opt.m_lineEnd, line_end_len );
+	}
+	return out.Flush();
+}
+
+int Table::ExtractColumns( TableColumns & out ) const
+{
+	out.m_rowNum = out.m_colNum = 0;
+	out.m_merges.clear();
+	for( auto & c : out.m_cols )
+		c.Clear();
+	if( GetType() != ElementTypeE::TABLE )
+		return SPD_ERR_BAD_PARAM;
+
+	// column is added when first seen, row shorter than others is padded at the end of row
+	auto get_col = [&out]( int col ) -> ColumnData & {
+		if( col >= (int)out.m_cols.size() )
+			out.m_cols.resize( col + 1 );
+		ColumnData & cd = out.m_cols[col];
+		if( col >= out.m_colNum ) {
+			out.m_colNum = col + 1;
+			cd.m_offset.assign( out.m_rowNum + 1, 0 );
+			cd.m_covered.assign( out.m_rowNum, 0 );
+		}
+		return cd;
+	};
+	auto end_row = [&out]( int col ) {
+		for( ; col < out.m_colNum; ++col ) {
+			ColumnData & cd = out.m_cols[col];
+			cd.m_offset.push_back( (uint32_t)cd.m_data.size() );
+			cd.m_covered.push_back( 0 );
+		}
+	};
+	std::vector<int> vopen;  // index of m_merges of open vmerge for each col, -1 if none
+
+	for( pugi::xml_node rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ) ) {
+		int col = 0;
+		for( pugi::xml_node cnd = rnd.child( "w:tc" ); !cnd.empty(); cnd = cnd.next_sibling( "w:tc" ) ) {
+			TCell cell = TCell( Element( cnd, ElementTypeE::TABLE_CELL ) );
+			int span = cell.GetSpanNum();
+			if( span < 1 )
+				span = 1;
+			if( col + span > (int)vopen.size() )
+				vopen.resize( col + span, -1 );
+			VMergeTypeE vt = cell.GetVMergeType();
+			int midx = -1;
+			bool covered = false;
+			if( vt == VMergeTypeE::CONT && vopen[col] >= 0 && out.m_merges[vopen[col]].m_col == col
+					&& out.m_merges[vopen[col]].m_row + out.m_merges[vopen[col]].m_rowSpan == out.m_rowNum ) {
+				midx = vopen[col];
+				out.m_merges[midx].m_rowSpan += 1;
+				covered = true;
+			}
+			else if( vt == VMergeTypeE::START || span > 1 ) {
+				midx = (int)out.m_merges.size();
+				MergeRange mr;
+				mr.m_row = out.m_rowNum;
+				mr.m_col = col;
+				mr.m_colSpan = span;
+				out.m_merges.push_back( mr );
+			}
+
+			for( int i = 0; i < span; ++i ) {
+				ColumnData & cd = get_col( col + i );
+				if( i == 0 && !covered )
+					for_each_cell_text( cnd, [&cd]( const char * text, size_t len ) { cd.m_data.insert( cd.m_data.end(), text, text + len ); } );
+				cd.m_offset.push_back( (uint32_t)cd.m_data.size() );
+				cd.m_covered.push_back( ( i > 0 || covered ) ? 1 : 0 );
+				vopen[col + i] = ( vt == VMergeTypeE::START || vt == VMergeTypeE::CONT ) ? midx : -1;
+			}
+			col += span;
+		}
+		for( int i = col; i < (int)vopen.size(); ++i )
+			vopen[i] = -1;
+		end_row( col );
+		out.m_rowNum += 1;
+	}
+
+	// vmerge start without continue is not merged
+	size_t n = 0;
+	for( size_t i = 0; i < out.m_merges.size(); ++i ) {
+		if( out.m_merges[i].m_rowSpan > 1 || out.m_merges[i].m_colSpan > 1 )
+			out.m_merges[n++] = out.m_merges[i];
+	}
+	out.m_merges.resize( n );
+	return SPD_ERR_OK;
+}
+
+int Table::Validate( std::vector<TableIssue> * issues ) const
+{
+	if( issues != nullptr )
+		issues->clear();
+	return check_table( issues, nullptr );
+}
+
+int Table::Repair()
+{
+	std::vector<TableFix> fixes;
+	int num = check_table( nullptr, &fixes );
+	if( num <= 0 )
+		return num;
+	for( const TableFix & fix : fixes )
+		fix_table( fix );
+	notify_change( m_nd, ChangeTypeE::MODIFY );
+	return num;
+}
+
+int Table::check_table( std::vector<TableIssue> * issues, std::vector<TableFix> * fixes ) const
+{
+	if( GetType() != ElementTypeE::TABLE )
+		return SPD_ERR_BAD_PARAM;
+	int num = 0;
+	auto issue = [&]( TableIssueE type, int row, int col, pugi::xml_node nd, int n ) {
+		++num;
+		if( issues != nullptr )
+			issues->push_back( TableIssue{ type, 0, row, col } );
+		if( fixes != nullptr )
+			fixes->push_back( TableFix{ type, nd, n } );
+	};
+
+	// vmerge state of previous row for each grid col : first col of cell and vmerge type
+	std::vector<int> vfirst;
+	std::vector<VMergeTypeE> vtype;
+	std::vector<int> rowcol;  // grid col covered by each row
+	int maxcol = 0;
+	int row = 0;
+	for( pugi::xml_node rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ), ++row ) {
+		int col = 0;
+		for( pugi::xml_node cnd = rnd.child( "w:tc" ); !cnd.empty(); cnd = cnd.next_sibling( "w:tc" ) ) {
+			pugi::xml_node snd = cnd.child( "w:tcPr" ).child( "w:gridSpan" );
+			int span = 1;
+			if( !snd.empty() ) {
+				span = snd.attribute( "w:val" ).as_int();
+				if( span < 1 ) {
+					issue( TableIssueE::BAD_SPAN, row, col, cnd, 0 );
+					span = 1;
 				}
 			}
-			else {
-				// start cell has no cont cell, should not happend
+
+			// unknown value is repaired to continue
+			VMergeTypeE vt = TCell::ReadVMergeType( cnd );
+			if( vt == VMergeTypeE::INVALID ) {
+				issue( TableIssueE::BAD_VMERGE, row, col, cnd, 0 );
+				vt = VMergeTypeE::CONT;
+			}
+			if( col + span > (int)vtype.size() ) {
+				vfirst.resize( col + span, -1 );
+				vtype.resize( col + span, VMergeTypeE::NONE );
 			}
+			// orphan is repaired to restart, cell below continue from it
+			if( vt == VMergeTypeE::CONT && ( vfirst[col] != col || vtype[col] == VMergeTypeE::NONE ) ) {
+				issue( TableIssueE::ORPHAN_CONT, row, col, cnd, 0 );
+				vt = VMergeTypeE::START;
+			}
+			for( int i = col; i < col + span; ++i ) {
+				vfirst[i] = col;
+				vtype[i] = vt;
+			}
+
+			if( cnd.child( "w:p" ).empty() )
+				issue( TableIssueE::EMPTY_CELL, row, col, cnd, 0 );
+			col += span;
+		}
+		// col not reached by this row has no vmerge
+		for( int i = col; i < (int)vtype.size(); ++i ) {
+			vfirst[i] = -1;
+			vtype[i] = VMergeTypeE::NONE;
+		}
+		rowcol.push_back( col );
+		if( maxcol < col )
+			maxcol = col;
+	}
+
+	if( row == 0 ) {
+		// repair add one row of all grid col
+		int colnum = GetColNum();
+		maxcol = colnum > 0 ? colnum : 1;
+		issue( TableIssueE::NO_ROW, -1, -1, m_nd, maxcol );
+	}
+	row = 0;
+	for( pugi::xml_node rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ), ++row ) {
+		if( rowcol[row] < maxcol )
+			issue( TableIssueE::SHORT_ROW, row, rowcol[row], rnd, maxcol - rowcol[row] );
+	}
+	if( GetColNum() != maxcol )
+		issue( TableIssueE::GRID_COL_NUM, -1, -1, m_nd, maxcol );
+	return num;
+}
+
+void Table::fix_table( const TableFix & fix )
+{
+	pugi::xml_node nd = fix.m_nd;
+	if( fix.m_type == TableIssueE::GRID_COL_NUM ) {
+		// keep width of existing column, new column use average width
+		int maxcol = fix.m_num;
+		pugi::xml_node grid = GetCreateChild( nd, "w:tblGrid" );
+		pugi::xml_node cnd = grid.child( "w:gridCol" );
+		int i = 0, total = 0;
+		for( ; i < maxcol && !cnd.empty(); ++i, cnd = cnd.next_sibling( "w:gridCol" ) )
+			total += cnd.attribute( "w:w" ).as_int();
+		while( !cnd.empty() ) {
+			pugi::xml_node next = cnd.next_sibling( "w:gridCol" );
+			grid.remove_child( cnd );
+			cnd = next;
+		}
+		int w = ( i > 0 ) ? total / i : 8100 / maxcol;
+		for( ; i < maxcol; ++i )
+			grid.append_child( "w:gridCol" ).append_attribute( "w:w" ) = w < 100 ? 100 : w;
+		return;
+	}
+	switch( fix.m_type )
+	{
+	case TableIssueE::BAD_SPAN:
+		nd.child( "w:tcPr" ).remove_child( "w:gridSpan" );
+		break;
+	case TableIssueE::BAD_VMERGE:
+		GetCreateAttr( nd.child( "w:tcPr" ).child( "w:vMerge" ), "w:val" ).set_value( "continue" );
+		break;
+	case TableIssueE::ORPHAN_CONT:
+		GetCreateAttr( nd.child( "w:tcPr" ).child( "w:vMerge" ), "w:val" ).set_value( "restart" );
+		break;
+	case TableIssueE::EMPTY_CELL:
+		nd.append_child( "w:p" );
+		break;
+	case TableIssueE::NO_ROW:
+		nd = nd.append_child( "w:tr" );
+		nd.append_child( "w:trPr" );
+		// fall through
+	case TableIssueE::SHORT_ROW:
+		for( int i = 0; i < fix.m_num; ++i ) {
+			pugi::xml_node cnd = nd.append_child( "w:tc" );
+			cnd.append_child( "w:tcPr" );
+			cnd.append_child( "w:p" );
 		}
-		else if( vmt == VMergeTypeE::CONT ) {
-			TRow prev_row1 = curr_row.GetPrev();
-			if( prev_row1.IsValid() ) {
-				TCell prev_cell1 = prev_row1.GetCell( curr_col );
-				VMergeTypeE type = prev_cell1.GetVMergeType();
-				if( type == VMergeTypeE::START ) {
-					TRow next_row1 = curr_row.GetNext();
-					if( next_row1.IsValid() ) {
-						TCell next_cell1 = next_row1.GetCell( curr_col );
-						if( next_cell1.GetVMergeType() != VMergeTypeE::CONT ) {
-							// prev cell is start cell, next cell is not a continue cell, no continue cell, so change prev cell to normal cell
-							prev_cell1.set_vmerge_type( VMergeTypeE::NONE );
-						}
-						else {
-							// next cell is cont cell, so no need to do anything
-						}
-					}
-					else {
-						// no next cell,, so no continue cell, so change prev cell to normal cell
-						prev_cell1.set_vmerge_type( VMergeTypeE::NONE );
-					}
+		break;
+	default:
+		break;
+	}
+	return;
+}
+
+// append a new cell with text, newline split paragraph
+static void append_text_cell( pugi::xml_node rnd, const std::string & field )
+{
+	pugi::xml_node cnd = rnd.append_child( "w:tc" );
+	cnd.append_child( "w:tcPr" );
+	size_t pos = 0;
+	do {
+		size_t end = field.find( '\n', pos );
+		if( end == std::string::npos )
+			end = field.size();
+		size_t len = end - pos;
+		if( len > 0 && field[pos + len - 1] == '\r' )
+			--len;
+		pugi::xml_node pnd = cnd.append_child( "w:p" );
+		if( len > 0 ) {
+			pugi::xml_node tnd = pnd.append_child( "w:r" ).append_child( "w:t" );
+			if( field[pos] == ' ' || field[pos + len - 1] == ' ' )
+				tnd.append_attribute( "xml:space" ).set_value( "preserve" );
+			tnd.text().set( field.data() + pos, len );
+		}
+		pos = end + 1;
+	} while( pos <= field.size() );
+	return;
+}
+
+int Table::ImportDelimited( TextSource & reader, const DelimitedOption & opt )
+{
+	if( GetType() != ElementTypeE::TABLE )
+		return SPD_ERR_BAD_PARAM;
+	reset_grid( 1 );
+
+	enum { FIELD_START, UNQUOTED, QUOTED, QUOTE_SEEN } state = FIELD_START;
+	std::string field;  // reused for every field
+	pugi::xml_node rnd;
+	int col = 0;
+	int maxcol = 0;
+	std::vector<int> rowcol;  // cell num of every row
+	bool skip_lf = false;
+	int ret = 0;
+	char buf[16384];
+
+	auto end_field = [&]() {
+		if( rnd.empty() ) {
+			rnd = m_nd.append_child( "w:tr" );
+			rnd.append_child( "w:trPr" );
+		}
+		append_text_cell( rnd, field );
+		field.clear();
+		++col;
+		state = FIELD_START;
+	};
+	auto end_record = [&]() {
+		if( rnd.empty() )
+			return;  // empty line
+		rowcol.push_back( col );
+		if( maxcol < col )
+			maxcol = col;
+		rnd = pugi::xml_node();
+		col = 0;
+	};
+
+	while( ( ret = reader.Read( buf, sizeof(buf) ) ) > 0 ) {
+		for( int i = 0; i < ret; ++i ) {
+			char c = buf[i];
+			if( skip_lf ) {
+				skip_lf = false;
+				if( c == '\n' && state != QUOTED )
+					continue;
+			}
+			bool newline = ( c == '\n' || c == '\r' );
+			switch( state ) {
+			case FIELD_START:
+			case UNQUOTED:
+			case QUOTE_SEEN:
+				if( c == opt.m_quote && state != UNQUOTED ) {
+					if( state == QUOTE_SEEN )
+						field.push_back( c );  // "" in quoted field
+					state = QUOTED;
+				}
+				else if( c == opt.m_delim ) {
+					end_field();
 				}
-				else if( type == VMergeTypeE::CONT ) {
-					// prev also cont cell, so no need to do anything
+				else if( newline ) {
+					if( state != FIELD_START || col > 0 )
+						end_field();
+					end_record();
+					skip_lf = ( c == '\r' );
 				}
 				else {
-					// cont cell has not prev cell, should not happend
+					field.push_back( c );
+					state = UNQUOTED;
 				}
-			}
-			else {
-				// cont cell has no prev row, should not happend
+				break;
+			case QUOTED:
+				if( c == opt.m_quote )
+					state = QUOTE_SEEN;
+				else
+					field.push_back( c );
+				break;
 			}
 		}
-		child = child.GetNext();
-		curr_col += span;
+	}
+	if( state != FIELD_START || col > 0 )
+		end_field();
+	end_record();
+
+	if( rowcol.empty() ) {
+		// table need one row at least
+		Reset( 1, 1 );
+		return ret < 0 ? ret : 0;
+	}
+	// pad short row
+	int row = 0;
+	for( rnd = m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ), ++row ) {
+		for( col = rowcol[row]; col < maxcol; ++col ) {
+			pugi::xml_node cnd = rnd.append_child( "w:tc" );
+			cnd.append_child( "w:tcPr" );
+			cnd.append_child( "w:p" );
+		}
+	}
+	set_grid_col( maxcol );
+	notify_change( m_nd, ChangeTypeE::MODIFY );
+	return ret < 0 ? ret : (int)rowcol.size();
+}
+
+int Table::DelRow( Element & row )
+{
+	if( row.m_nd.parent() != m_nd || GetTagId( row.m_nd ) != TagIdE::W_TR )
+		return SPD_ERR_BAD_PARAM;
+	return del_rows( row.m_nd, 1 );
+}
+
+int Table::DelRows( int first, int count )
+{
+	if( first < 0 || count < 1 )
+		return SPD_ERR_BAD_PARAM;
+	pugi::xml_node rnd = m_nd.child( "w:tr" );
+	for( int i = 0; i < first && !rnd.empty(); ++i )
+		rnd = rnd.next_sibling( "w:tr" );
+	if( rnd.empty() )
+		return SPD_ERR_BAD_PARAM;
+	return del_rows( rnd, count );
+}
+
+// cell cover each grid col of row, and its vmerge type
+void Table::get_row_cells( pugi::xml_node rnd, std::vector<pugi::xml_node> & cells, std::vector<VMergeTypeE> & types )
+{
+	cells.clear();
+	types.clear();
+	for( pugi::xml_node cnd = rnd.child( "w:tc" ); !cnd.empty(); cnd = cnd.next_sibling( "w:tc" ) ) {
+		TCell cell = TCell( Element( cnd, ElementTypeE::TABLE_CELL ) );
+		int span = cell.GetSpanNum();
+		VMergeTypeE vt = cell.GetVMergeType();
+		for( int i = 0; i < ( span < 1 ? 1 : span ); ++i ) {
+			cells.push_back( cnd );
+			types.push_back( vt );
+		}
+	}
+	return;
+}
+
+int Table::del_rows( pugi::xml_node first, int count )
+{
+	// range is [first, last), last is the row below range
+	pugi::xml_node last = first;
+	for( int i = 0; i < count; ++i ) {
+		if( last.empty() )
+			return SPD_ERR_BAD_PARAM;  // not enough row
+		last = last.next_sibling( "w:tr" );
+	}
+	pugi::xml_node above = first.previous_sibling( "w:tr" );
+
+	// vmerge only need repair at boundary, read all state before modify
+	std::vector<pugi::xml_node> above_cells, below_cells, next_cells;
+	std::vector<VMergeTypeE> above_types, below_types, next_types;
+	get_row_cells( above, above_cells, above_types );
+	get_row_cells( last, below_cells, below_types );
+
+	// merge restart inside range split the merge above and below
+	std::vector<bool> restart;
+	pugi::xml_node rnd = first;
+	for( int i = 0; i < count; ++i, rnd = rnd.next_sibling( "w:tr" ) ) {
+		get_row_cells( rnd, next_cells, next_types );
+		if( restart.size() < next_types.size() )
+			restart.resize( next_types.size(), false );
+		for( size_t col = 0; col < next_types.size(); ++col ) {
+			if( next_types[col] == VMergeTypeE::START )
+				restart[col] = true;
+		}
+	}
+	get_row_cells( last.next_sibling( "w:tr" ), next_cells, next_types );
+
+	// merge of above row at col continue to below row after delete
+	auto is_joined = [&]( size_t col ) {
+		return col < above_types.size() && ( above_types[col] == VMergeTypeE::START || above_types[col] == VMergeTypeE::CONT )
+			&& col < below_types.size() && below_types[col] == VMergeTypeE::CONT
+			&& !( col < restart.size() && restart[col] );
+	};
+	std::vector< std::pair<pugi::xml_node, VMergeTypeE> > fix;
+	for( size_t col = 0; col < below_cells.size(); ++col ) {
+		// continue cell below the range, its start is deleted
+		if( below_types[col] != VMergeTypeE::CONT || is_joined( col ) )
+			continue;
+		if( col > 0 && below_cells[col] == below_cells[col - 1] )
+			continue;  // span cell already handled
+		bool more = col < next_types.size() && next_types[col] == VMergeTypeE::CONT;
+		fix.push_back( std::make_pair( below_cells[col], more ? VMergeTypeE::START : VMergeTypeE::NONE ) );
+	}
+	for( size_t col = 0; col < above_cells.size(); ++col ) {
+		// start cell above the range, all its continue cell is deleted
+		if( above_types[col] != VMergeTypeE::START || is_joined( col ) )
+			continue;
+		if( col > 0 && above_cells[col] == above_cells[col - 1] )
+			continue;
+		fix.push_back( std::make_pair( above_cells[col], VMergeTypeE::NONE ) );
 	}
 
-	return m_nd.remove_child( row.m_nd ) ? SPD_ERR_OK : SPD_ERR_INTERNAL;
+	// unlink range in one pass
+	rnd = first;
+	for( int i = 0; i < count; ++i ) {
+		pugi::xml_node next = rnd.next_sibling( "w:tr" );
+		notify_change( rnd, ChangeTypeE::REMOVE );
+		m_nd.remove_child( rnd );
+		rnd = next;
+	}
+	for( auto & f : fix ) {
+		TCell( Element( f.first, ElementTypeE::TABLE_CELL ) ).set_vmerge_type( f.second );
+	}
+	notify_change( m_nd, ChangeTypeE::MODIFY );
+	return SPD_ERR_OK;
 }
 
 Paragraph Table::AddSiblingParagraph( bool add_next )
 {
 	pugi::xml_node nd = add_next ? m_nd.parent().insert_child_after( "w:p", m_nd )
 		: m_nd.parent().insert_child_before( "w:p", m_nd );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Paragraph( Element( nd ) );
 }
 
@@ -1117,6 +2207,7 @@ Table Table::AddSiblingTable( bool add_next )
 		: m_nd.parent().insert_child_before( "w:tbl", m_nd );
 	Table tbl = Element( nd );
 	tbl.Reset();
+	notify_change( nd, ChangeTypeE::INSERT );
 	return tbl;
 }
 
@@ -1190,6 +2281,7 @@ TRow TRow::AddSiblingTRow( bool add_next )
 		}
 	}
 
+	notify_change( nd, ChangeTypeE::INSERT );
 	return TRow( Element( nd ) );
 }
 
@@ -1217,21 +2309,20 @@ int TCell::GetSpanNum() const
 
 VMergeTypeE TCell::GetVMergeType() const
 {
-	VMergeTypeE vmerge_type = VMergeTypeE::INVALID;
-	pugi::xml_node pnd = m_nd.child( "w:tcPr" ).child( "w:vMerge" );
-	if( !pnd.empty() ) {
-		pugi::xml_attribute attr = pnd.attribute( "w:val" );
-		if( !attr.empty() && strcmp( attr.value(), "restart" ) == 0 )
-			vmerge_type = VMergeTypeE::START;
-		else if( !attr.empty() && strcmp( attr.value(), "continue" ) == 0 )
-			vmerge_type = VMergeTypeE::CONT;
-		else
-			vmerge_type = VMergeTypeE::INVALID;
-	}
-	else {
-		vmerge_type = VMergeTypeE::NONE;
-	}
-	return vmerge_type;
+	return ReadVMergeType( m_nd );
+}
+
+VMergeTypeE TCell::ReadVMergeType( pugi::xml_node tc )
+{
+	pugi::xml_node pnd = tc.child( "w:tcPr" ).child( "w:vMerge" );
+	if( pnd.empty() )
+		return VMergeTypeE::NONE;
+	pugi::xml_attribute attr = pnd.attribute( "w:val" );
+	if( attr.empty() || strcmp( attr.value(), "continue" ) == 0 )
+		return VMergeTypeE::CONT;
+	if( strcmp( attr.value(), "restart" ) == 0 )
+		return VMergeTypeE::START;
+	return VMergeTypeE::INVALID;
 }
 
 TCell TCell::GetVMergeStartCell() const
@@ -1310,21 +2401,202 @@ int TCell::GetVMergeNum() const
 std::string TCell::GetText() const
 {
 	std::string text;
-	bool is_first = true;
+	GetText( text );
+	return text;
+}
+
+int TCell::GetText( std::string & out ) const
+{
 	// only get paragraph text, ignore table in table
-	for( Element ele = GetFirstChild(); ele.IsValid(); ele = ele.GetNext() ) {
-		if( ele.GetType() != ElementTypeE::PARAGRAPH )
-			continue;
-		Paragraph par = ele;
-		if( is_first ) {
-			is_first = false;
+	size_t len = out.size();
+	for_each_cell_text( m_nd, [&out]( const char * text, size_t size ) { out.append( text, size ); } );
+	return (int)( out.size() - len );
+}
+
+void TableGrid::Clear()
+{
+	m_rowNum = m_colNum = 0;
+	m_cells.clear();
+	m_grid.clear();
+	m_cellIdx.clear();
+	return;
+}
+
+int TableGrid::Build( const Table & tbl )
+{
+	Clear();
+	if( tbl.GetType() != ElementTypeE::TABLE )
+		return SPD_ERR_BAD_PARAM;
+
+	// one pass over cells, open vmerge of every grid col is tracked in vopen
+	m_colNum = tbl.GetColNum();
+	std::vector<int> vopen( m_colNum > 0 ? m_colNum : 0, -1 );
+	int row = 0;
+	for( pugi::xml_node rnd = tbl.m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ), ++row ) {
+		int col = 0;
+		for( pugi::xml_node cnd = rnd.child( "w:tc" ); !cnd.empty(); cnd = cnd.next_sibling( "w:tc" ) ) {
+			TCell cell = TCell( Element( cnd, ElementTypeE::TABLE_CELL ) );
+			int span = cell.GetSpanNum();
+			if( span < 1 )
+				span = 1;
+			if( col + span > (int)vopen.size() )
+				vopen.resize( col + span, -1 );
+
+			int idx = -1;
+			VMergeTypeE vt = cell.GetVMergeType();
+			if( vt == VMergeTypeE::CONT && vopen[col] >= 0 && m_cells[vopen[col]].m_col == col
+					&& m_cells[vopen[col]].m_row + m_cells[vopen[col]].m_rowSpan == row ) {
+				idx = vopen[col];
+				m_cells[idx].m_rowSpan += 1;
+			}
+			else {
+				// bad continue without start is treat as normal cell
+				idx = (int)m_cells.size();
+				CellInfo info;
+				info.m_cell = cell;
+				info.m_row = row;
+				info.m_col = col;
+				info.m_colSpan = span;
+				m_cells.push_back( info );
+			}
+			for( int i = col; i < col + span; ++i )
+				vopen[i] = ( vt == VMergeTypeE::START || vt == VMergeTypeE::CONT ) ? idx : -1;
+			m_cellIdx[cnd.internal_object()] = idx;
+			col += span;
 		}
-		else {
-			text.append( "\n" );
+		// short row, close vmerge not reached
+		for( int i = col; i < (int)vopen.size(); ++i )
+			vopen[i] = -1;
+	}
+	m_rowNum = row;
+	if( m_colNum < (int)vopen.size() )
+		m_colNum = (int)vopen.size();  // row wider than w:tblGrid
+
+	m_grid.assign( (size_t)m_rowNum * m_colNum, -1 );
+	for( int idx = 0; idx < (int)m_cells.size(); ++idx ) {
+		const CellInfo & info = m_cells[idx];
+		for( int r = info.m_row; r < info.m_row + info.m_rowSpan; ++r ) {
+			for( int c = info.m_col; c < info.m_col + info.m_colSpan; ++c )
+				m_grid[(size_t)r * m_colNum + c] = idx;
 		}
-		text.append( par.GetText() );
 	}
-	return text;
+	return SPD_ERR_OK;
+}
+
+const TableGrid::CellInfo * TableGrid::GetOwner( int row, int col ) const
+{
+	if( row < 0 || row >= m_rowNum || col < 0 || col >= m_colNum )
+		return nullptr;
+	int idx = m_grid[(size_t)row * m_colNum + col];
+	return idx < 0 ? nullptr : &m_cells[idx];
+}
+
+const TableGrid::CellInfo * TableGrid::Find( const TCell & cell ) const
+{
+	auto it = m_cellIdx.find( cell.m_nd.internal_object() );
+	return it == m_cellIdx.end() ? nullptr : &m_cells[it->second];
+}
+
+// position of first child named name, append one if not exist
+static int get_create_pos( pugi::xml_node parent, const char * name )
+{
+	int pos = 0;
+	for( pugi::xml_node nd = parent.first_child(); !nd.empty(); nd = nd.next_sibling(), ++pos ) {
+		if( strcmp( nd.name(), name ) == 0 )
+			return pos;
+	}
+	parent.append_child( name );
+	return pos;
+}
+
+// remove all child except the property child named prop and node keep
+static void keep_child( pugi::xml_node parent, const char * prop, pugi::xml_node keep )
+{
+	pugi::xml_node next;
+	for( pugi::xml_node nd = parent.first_child(); !nd.empty(); nd = next ) {
+		next = nd.next_sibling();
+		if( nd != keep && strcmp( nd.name(), prop ) != 0 )
+			parent.remove_child( nd );
+	}
+	return;
+}
+
+int TRowAppender::Init( const Table & tbl, const TRow & proto )
+{
+	m_tbl = Table( Element() );
+	m_proto.reset();
+	m_cellPos.clear();
+	m_textPos.clear();
+	if( tbl.GetType() != ElementTypeE::TABLE || proto.GetType() != ElementTypeE::TABLE_ROW )
+		return SPD_ERR_BAD_PARAM;
+
+	pugi::xml_node row = m_proto.append_copy( proto.m_nd );
+	// id should be unique in document, and vmerge of appended row is meaningless
+	for( pugi::xml_node nd = row; !nd.empty(); ) {
+		nd.remove_attribute( "w14:paraId" );
+		nd.remove_attribute( "w14:textId" );
+		if( !nd.first_child().empty() ) {
+			nd = nd.first_child();
+			continue;
+		}
+		while( nd != row && nd.next_sibling().empty() )
+			nd = nd.parent();
+		nd = ( nd == row ) ? pugi::xml_node() : nd.next_sibling();
+	}
+
+	// cell skeleton : w:tc -> w:tcPr, w:p -> w:pPr, w:r -> w:rPr, w:t
+	int pos = 0;
+	for( pugi::xml_node cnd = row.first_child(); !cnd.empty(); cnd = cnd.next_sibling(), ++pos ) {
+		if( strcmp( cnd.name(), "w:tc" ) != 0 )
+			continue;
+		cnd.child( "w:tcPr" ).remove_child( "w:vMerge" );
+		pugi::xml_node pnd = cnd.child( "w:p" );
+		keep_child( cnd, "w:tcPr", pnd );
+		m_textPos.push_back( get_create_pos( cnd, "w:p" ) );
+		pnd = cnd.child( "w:p" );
+		pugi::xml_node rnd = pnd.child( "w:r" );
+		keep_child( pnd, "w:pPr", rnd );
+		m_textPos.push_back( get_create_pos( pnd, "w:r" ) );
+		rnd = pnd.child( "w:r" );
+		keep_child( rnd, "w:rPr", rnd.child( "w:t" ) );
+		m_textPos.push_back( get_create_pos( rnd, "w:t" ) );
+		rnd.child( "w:t" ).text().set( "" );
+		m_cellPos.push_back( pos );
+	}
+	m_tbl = tbl;
+	return SPD_ERR_OK;
+}
+
+// n-th child, n is position from get_create_pos()
+static pugi::xml_node nth_child( pugi::xml_node parent, int n )
+{
+	pugi::xml_node nd = parent.first_child();
+	for( ; n > 0 && !nd.empty(); --n )
+		nd = nd.next_sibling();
+	return nd;
+}
+
+TRow TRowAppender::Append( const std::string_view * values, size_t num )
+{
+	if( !m_tbl.IsValid() || m_proto.first_child().empty() )
+		return TRow( Element() );
+	pugi::xml_node row = m_tbl.m_nd.append_copy( m_proto.first_child() );
+
+	// cell is in child order, walk row child once
+	pugi::xml_node cnd = row.first_child();
+	int pos = 0;
+	for( size_t i = 0; i < m_cellPos.size() && i < num; ++i ) {
+		for( ; pos < m_cellPos[i]; ++pos )
+			cnd = cnd.next_sibling();
+		if( values[i].empty() )
+			continue;
+		pugi::xml_node tnd = nth_child( nth_child( nth_child( cnd, m_textPos[i * 3] ), m_textPos[i * 3 + 1] ), m_textPos[i * 3 + 2] );
+		if( values[i].front() == ' ' || values[i].back() == ' ' )
+			Element::GetCreateAttr( tnd, "xml:space" ).set_value( "preserve" );
+		tnd.text().set( values[i].data(), values[i].size() );
+	}
+	Element::notify_change( row, ChangeTypeE::INSERT );
+	return TRow( Element( row, ElementTypeE::TABLE_ROW ) );
 }
 
 int TCell::set_row_span( int num )
@@ -1379,6 +2651,7 @@ int TCell::merge_cell_after( int num )
 	pugi::xml_node parent = m_nd.parent();
 	int i;
 	for( i = 0; i < num; ++i ) {
+		notify_change( m_nd.next_sibling(), ChangeTypeE::REMOVE );
 		parent.remove_child( m_nd.next_sibling() );
 	}
 	return SPD_ERR_OK;
@@ -1452,6 +2725,8 @@ int TCell::SetSpanNum( int num )
 			}
 		}
 	}
+	// span and vmerge change may affect other row, notify whole table
+	notify_change( m_nd.parent().parent(), ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
@@ -1538,12 +2813,15 @@ int TCell::SetVMergeNum( int num )
 		}
 	}
 
+	// span and vmerge change may affect other row, notify whole table
+	notify_change( m_nd.parent().parent(), ChangeTypeE::MODIFY );
 	return SPD_ERR_OK;
 }
 
 Paragraph TCell::AddChildParagraph( bool add_back )
 {
 	pugi::xml_node nd = add_back ? m_nd.append_child( "w:p" ) : m_nd.prepend_child( "w:p" );
+	notify_change( nd, ChangeTypeE::INSERT );
 	return Paragraph( Element( nd ) );
 }
 
@@ -1552,6 +2830,7 @@ Table TCell::AddChildTable( bool add_back )
 	pugi::xml_node nd = add_back ? m_nd.append_child( "w:tbl" ) : m_nd.prepend_child( "w:tbl" );
 	Table tbl = Element( nd );
 	tbl.Reset();
+	notify_change( nd, ChangeTypeE::INSERT );
 	return tbl;
 }
 
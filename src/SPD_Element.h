@@ -20,7 +20,14 @@
 #include "SPD_Common.h"
 
 #include <pugixml.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 BEGIN_NS_SPD
@@ -50,10 +57,53 @@ enum class ElementTypeE : uint8_t
 	MAX
 };
 
+// known tag id, compare tag id instead of strcmp tag name
+enum class TagIdE : uint8_t
+{
+	UNKNOWN,  // unknown tag or not element node
+
+	W_P,          // w:p
+	W_R,          // w:r
+	W_T,          // w:t
+	W_HYPERLINK,  // w:hyperlink
+	W_TBL,        // w:tbl
+	W_TR,         // w:tr
+	W_TC,         // w:tc
+
+	W_PPR,        // w:pPr
+	W_RPR,        // w:rPr
+	W_TBLPR,      // w:tblPr
+	W_TBLGRID,    // w:tblGrid
+	W_TRPR,       // w:trPr
+	W_TCPR,       // w:tcPr
+	W_SECTPR,     // w:sectPr
+
+	W_DRAWING,    // w:drawing
+	W_OBJECT,     // w:object
+
+	W_BOOKMARK_START,        // w:bookmarkStart
+	W_BOOKMARK_END,          // w:bookmarkEnd
+	W_COMMENT_RANGE_START,   // w:commentRangeStart
+	W_COMMENT_RANGE_END,     // w:commentRangeEnd
+	W_COMMENT_REFERENCE,     // w:commentReference
+
+	MAX
+};
+
+// change notify to owner Document, used for modify tracking
+enum class ChangeTypeE : uint8_t
+{
+	MODIFY,   // node attribute or content or child changed
+	INSERT,   // node is new inserted
+	REMOVE,   // node will be removed
+};
+
 class Relationship;
 class Document;
 class ElementIterator;
 class ElementRange;
+template< class T > class TypedElementIterator;
+template< class T > class TypedElementRange;
 
 class Paragraph;
 class Hyperlink;
@@ -61,6 +111,7 @@ class Run;
 class Table; 
 class TRow;
 class TCell;
+class TextReplacer;
 
 extern const std::string g_ElementEmptyStr;
 
@@ -69,17 +120,17 @@ class SPD_API Element
 protected:
 	friend class Document;
 	Element( pugi::xml_node nd );
+	Element( pugi::xml_node nd, ElementTypeE type ) : m_nd( nd ), m_type( nd.empty() ? ElementTypeE::INVALID : type ) { }  // nd already classified
 
 public:
+	// handle is trivially copyable value ( node pointer + type ), copy / assign / destroy are implicit
 	Element() : m_type( ElementTypeE::INVALID ) { }
-	Element( const Element & ele ) : m_nd( ele.m_nd ), m_type( ele.m_type ) { }
-	~Element() { m_type = ElementTypeE::INVALID; }
 
 	static ElementTypeE GetNodeType( pugi::xml_node nd );
+	static TagIdE GetTagId( pugi::xml_node nd );
+	static TagIdE GetTagId( const char * name );
 
 public:
-	Element & operator = ( const Element & ele ) { if( &ele != this ) m_nd = ele.m_nd, m_type = ele.m_type; return *this; }
-
 	bool IsValid() const { return (m_type != ElementTypeE::INVALID) && (! m_nd.empty()); }
 	operator bool() const { return IsValid(); }
 	bool operator ! () const { return !IsValid(); }
@@ -109,6 +160,8 @@ public:
 	inline ElementIterator begin() const;
 	inline ElementIterator end() const;
 	inline ElementRange Children() const;
+	// child of type T only ( Paragraph, Run, TCell ... ), ex : for( TCell cell : row.Children<TCell>() )
+	template< class T > inline TypedElementRange<T> Children() const;
 
 	// add child and add sibling need to define in each child type
 	
@@ -120,14 +173,24 @@ public:
 	static pugi::xml_node GetCreateChild( pugi::xml_node parent, const char * name );
 	static pugi::xml_attribute GetCreateAttr( pugi::xml_node nd, const char * name );
 
+protected:
+	// every modify through Element api should notify, REMOVE must notify before remove
+	static void notify_change( pugi::xml_node nd, ChangeTypeE type );
+	static ElementTypeE get_tag_type( pugi::xml_node nd, TagIdE tag );
+	// type of w:r depends on child, call after child changed
+	void update_type() { m_type = GetNodeType( m_nd ); }
+
 protected:
 	friend class ElementIterator;
+	template< class T > friend class TypedElementIterator;
 	friend class Paragraph;
 	friend class Hyperlink;
 	friend class Run;
 	friend class Table;
 	friend class TRow;
 	friend class TCell;
+	friend class TableGrid;
+	friend class TRowAppender;
 	pugi::xml_node m_nd;
 
 private:
@@ -177,6 +240,69 @@ inline ElementIterator Element::begin() const { return ElementIterator( GetFirst
 inline ElementIterator Element::end() const { return ElementIterator(); }
 inline ElementRange Element::Children() const { return ElementRange(begin(), end()); }
 
+// run property, field is valid only if its bit is set in m_mask
+// partial in style or direct w:rPr, merged by Merge() from docDefaults to direct format
+class SPD_API RunFormat
+{
+public:
+	enum MaskE : uint32_t
+	{
+		BOLD = 1 << 0,
+		ITALIC = 1 << 1,
+		UNDERLINE = 1 << 2,
+		STRIKE = 1 << 3,
+		DSTRIKE = 1 << 4,
+		COLOR = 1 << 5,
+		HIGHLIGHT = 1 << 6,
+		SIZE = 1 << 7,
+		FONT = 1 << 8,
+	};
+
+	uint32_t m_mask = 0;
+	bool m_bold = false;
+	bool m_italic = false;
+	bool m_strike = false;
+	bool m_dstrike = false;
+	std::string m_underline;  // ex : "single", empty means none
+	std::string m_color;      // ex : "00B0F0", "auto"
+	std::string m_highlight;  // ex : "yellow"
+	std::string m_font;       // w:rFonts w:ascii
+	int m_size = 0;           // half point, ex : 21 is 10.5pt
+
+	int Load( pugi::xml_node rpr );  // read w:rPr, return set field num
+	void Merge( const RunFormat & over );  // field set in over overwrite this
+	// merge character style on paragraph style, toggle property ( bold, italic, strike, dstrike ) set in over is xor
+	void Toggle( const RunFormat & over );
+};
+
+// paragraph property, m_run is run property of style ( base of run in paragraph ), not of paragraph mark
+class SPD_API ParaFormat
+{
+public:
+	enum MaskE : uint32_t
+	{
+		ALIGN = 1 << 0,
+		SPACE_BEFORE = 1 << 1,
+		SPACE_AFTER = 1 << 2,
+		IND_LEFT = 1 << 3,
+		IND_FIRST = 1 << 4,
+		NUMBER = 1 << 5,
+	};
+
+	uint32_t m_mask = 0;
+	std::string m_align;   // w:jc, ex : "left", "center", "both"
+	int m_spaceBefore = 0; // twip
+	int m_spaceAfter = 0;
+	int m_indLeft = 0;
+	int m_indFirst = 0;    // hanging is negative
+	std::string m_numId;
+	int m_numLevel = 0;
+	RunFormat m_run;
+
+	int Load( pugi::xml_node ppr );  // read w:pPr except paragraph mark w:rPr, return set field num
+	void Merge( const ParaFormat & over );  // include m_run
+};
+
 // NOTE : top level is Paragraph or Table
 
 class SPD_API Paragraph : public Element
@@ -187,20 +313,25 @@ protected:
 
 public:
 	Paragraph( const Element & ele ) : Element( ele ) { }
-	virtual ~Paragraph() { }
 
 public:
 	const char * GetStyleId() const;
 	const char * GetStyleName( const Document & doc ) const; // style name, ex : heading 1
+	// docDefaults + style basedOn chain ( or default paragraph style ) + direct w:pPr, m_run is base of child run
+	ParaFormat GetEffectiveFormat( const Document & doc ) const;
 	const char * GetNumId() const;    // nullptr means no numid, use style default
 	int GetNumLevel() const;          // -1 means no level, use style default
 	std::string GetText() const;
+	int GetText( std::string & out ) const;  // append to out, reuse its buffer, return appended length
 
 	int SetStyleId( const char * id ); // id must valid in doc
 	int SetStyleName( const char * name, const Document & doc );
 	int SetNumId( const char * id ); // empty means remove numid, use style default
 	int SetNumLevel( int level ); // use with SetNumId(), -1 means remove numlevel, use style default
 	// Text can not set directly, need to set child run
+	// replace all pattern of rep in text of child run ( include run in hyperlink ) in one pass, return replaced num
+	// pattern may cross run, replacement take format of the run where match begin, emptied run is removed
+	int Replace( const TextReplacer & rep );
 
 	// NOTE : child is Run or Hyperlink ( or Bookmark or Comment )
 	Run AddChildRun( bool add_back = true );
@@ -219,7 +350,6 @@ protected:
 
 public:
 	Hyperlink( const Element & ele ) : Element( ele ) { }
-	virtual ~Hyperlink() { }
 
 public:
 	const char * GetAnchor() const;          // local bookmark link
@@ -229,6 +359,7 @@ public:
 	const std::string & GetRelaTargetMode( const Document & doc ) const; // hyperlink mode, internal : "", external : "External"
 	const std::string & GetRelaTarget( const Document & doc ) const;     // hyperlink target, internal : "media/image1.png", external : "http://xxx.org"
 	std::string GetText() const;
+	int GetText( std::string & out ) const;  // append to out, return appended length
 
 	int SetAnchor( const char * anchor );          // local bookmark link
 	int SetRelaId( const char * relid );   // remote hiperlink
@@ -250,7 +381,6 @@ protected:
 
 public:
 	Run( const Element & ele ) : Element( ele ) { }
-	virtual ~Run() { }
 
 public:
 	bool IsText() const;	 // text or not
@@ -265,6 +395,10 @@ public:
 	bool GetStrike() const;            // font deleted with strike
 	bool GetDoubleStrike() const;      // font deleted with double strike, can not both exist with strike
 	std::string GetText() const;
+	int GetText( std::string & out ) const;  // append to out, return appended length
+	// format of paragraph style + character style ( w:rStyle ) basedOn chain + direct w:rPr,
+	// bold / italic / strike / dstrike of character style toggle the paragraph style
+	RunFormat GetEffectiveFormat( const Document & doc ) const;
 
 	int SetColor( const char * color );
 	int SetHighline( const char * color );
@@ -302,6 +436,51 @@ public:
 
 class TRow;
 class TCell;
+class TableColumns;
+
+enum class VMergeTypeE : int8_t
+{
+	INVALID = -1,
+	NONE = 0,      // no vmerge, normal cell
+	START,
+	CONT,
+};
+
+enum class TableIssueE : uint8_t
+{
+	NO_ROW,          // table has no w:tr
+	GRID_COL_NUM,    // w:tblGrid column num not match widest row
+	SHORT_ROW,       // row cover less grid column than widest row
+	BAD_SPAN,        // gridSpan < 1 or not number
+	BAD_VMERGE,      // vMerge value is not restart or continue ( no value means continue )
+	ORPHAN_CONT,     // vMerge continue without start or continue above
+	EMPTY_CELL,      // w:tc without w:p
+};
+
+class SPD_API TableIssue
+{
+public:
+	TableIssueE m_type;
+	int m_table;  // index of table in document order ( same as Document::ExtractTables ), 0 for Table::Validate()
+	int m_row;  // -1 if not for a row
+	int m_col;  // grid col, -1 if not for a cell
+};
+
+// how merged cell is written to delimited text, the grid position covered by span or vmerge
+enum class MergedCellE : uint8_t
+{
+	EMPTY,   // text at top left position, other covered position is empty
+	REPEAT,  // text is repeated at every covered position
+};
+
+class SPD_API DelimitedOption
+{
+public:
+	char m_delim = ',';        // ',' for csv, '\t' for tsv
+	char m_quote = '"';        // field with delim, quote or newline is quoted, quote in field is doubled
+	MergedCellE m_merged = MergedCellE::EMPTY;
+	const char * m_lineEnd = "\r\n";  // export only, import accept "\r\n", "\n" and "\r"
+};
 
 class SPD_API Table : public Element
 {
@@ -311,7 +490,6 @@ protected:
 
 public:
 	Table( const Element & ele ) : Element( ele ) { }
-	virtual ~Table() { }
 
 public:
 	int GetRowNum() const;
@@ -321,18 +499,56 @@ public:
 	int GetColWidth( int idx ) const;  
 
 	int Reset(int row = 1, int col = 1); // row and col should >= 1, col should < 80;
+	// replace all row with cells.size() x ( longest row ) cells, short row is filled with empty cell, col should <= 80
+	// colStyle[i] is paragraph style id of column i, empty or missing means no style
+	int Fill( const std::vector< std::vector<std::string> > & cells, const std::vector<std::string> & colStyle = {} );
+	int Fill( const std::vector< std::vector<std::string_view> > & cells, const std::vector<std::string> & colStyle = {} );
+	// one record per row, one field per grid column ( short row is padded ), paragraphs in cell is joined by '\n'
+	int ExportDelimited( TextSink & writer, const DelimitedOption & opt = DelimitedOption() ) const;
+	// replace all row with records of reader, newline in field split paragraphs, empty line is skipped
+	// no merged cell is created, return row num or < 0 if failed
+	int ImportDelimited( TextSource & reader, const DelimitedOption & opt = DelimitedOption() );
+	// all text and merge info in one pass, buffers of out are reused, nested table in cell is ignored
+	int ExtractColumns( TableColumns & out ) const;
+	// check grid / span / vmerge consistency in one pass, return issue num, 0 means ok
+	int Validate( std::vector<TableIssue> * issues = nullptr ) const;
+	// fix all issue of Validate() in one pass, return fixed num
+	// bad span is 1, bad vmerge is continue, orphan continue is start, short row is padded with empty cell, grid follow widest row
+	int Repair();
 
 	// NOTE : child is Row, if set Col, update all child
 	int AddCol( int index ); // insert new column at index, index begin from 0
 	int DelCol( int index ); // del column at index, index begin from 0
+	// insert count columns at index in one pass, widths is empty ( split from neighbor ) or count widths
+	// if index is inside a span cell, the span is extended
+	int AddCols( int index, int count, const std::vector<int> & widths = {} );
+	int DelCols( int index, int count ); // del columns [index, index + count), at least one column left
 	int SetColWidth( const std::vector<int> widths ); // min col width is 100, usually shound not < 300
 
 	TRow AddChildTRow( bool add_back = true );
 	int DelRow( Element & row ); // del row, row must exist, need special handle of Cell with VMerge
+	int DelRows( int first, int count ); // del rows [first, first + count), vmerge is repaired once at boundary
 
 	// NOTE : sibling is Paragraph or Table
 	Paragraph AddSiblingParagraph( bool add_next = true );
 	Table AddSiblingTable( bool add_next = true );
+
+private:
+	template< class S > int fill_rows( const std::vector< std::vector<S> > & cells, const std::vector<std::string> & colStyle );
+	void reset_grid( int col );
+	void set_grid_col( int col );
+	int del_rows( pugi::xml_node first, int count );
+	// node to repair for one issue : table, row, or cell, m_num is col num of table or row
+	class TableFix
+	{
+	public:
+		TableIssueE m_type;
+		pugi::xml_node m_nd;
+		int m_num;
+	};
+	int check_table( std::vector<TableIssue> * issues, std::vector<TableFix> * fixes ) const;  // read only
+	static void fix_table( const TableFix & fix );
+	static void get_row_cells( pugi::xml_node rnd, std::vector<pugi::xml_node> & cells, std::vector<VMergeTypeE> & types );
 };
 
 class SPD_API TRow : public Element
@@ -343,7 +559,6 @@ private:
 
 public: 
 	TRow( const Element & ele ) : Element( ele ) { }
-	virtual ~TRow() { }
 
 public:
 	int GetColNum() const { Table tb = Table( GetParent() ); return tb.GetColNum(); }
@@ -359,14 +574,6 @@ public:
 	TRow AddSiblingTRow( bool add_next = true );
 };
 
-enum class VMergeTypeE : int8_t
-{
-	INVALID = -1,
-	NONE = 0,      // no vmerge, normal cell
-	START,
-	CONT,
-};
-
 class SPD_API TCell : public Element
 {
 private:
@@ -375,15 +582,17 @@ private:
 
 public:
 	TCell( const Element & ele ) : Element( ele ) { }
-	virtual ~TCell() { }
 
 public:
 	int GetCol() const;
 	int GetSpanNum() const;       // 1 means no span, has span should >= 1
 	VMergeTypeE GetVMergeType() const;
+	// vmerge of w:tc node, w:vMerge without w:val is continue ( written by Word )
+	static VMergeTypeE ReadVMergeType( pugi::xml_node tc );
 	TCell GetVMergeStartCell() const;
 	int GetVMergeNum() const;     // 1 means no vmerge, vmerge start / vmerge cont should > 1
 	std::string GetText() const;  // only paragraph, ignore table
+	int GetText( std::string & out ) const;  // append to out, paragraph joined by "\n", return appended length
 
 	// NOTE : modify Span/VMerge only can modify first Cell in Span/VMerge, and following cell should be no span/merge
 	int SetSpanNum( int num ); // 1 means no span, more span num will remove sibling TCell, can not set VCONT
@@ -405,6 +614,187 @@ private:
 	int set_vmerge_type( VMergeTypeE type );  // use for adjust sibling TCell VMergeType only, not for public use
 };
 
+// row x col occupancy of a Table, gridSpan and vMerge resolved in one pass
+// grid is a snapshot, rebuild it after table structure changed ( or use Document::GetTableGrid() )
+class SPD_API TableGrid
+{
+public:
+	struct CellInfo
+	{
+		TCell m_cell{ Element() };  // first cell, vmerge start cell if vertical merged
+		int m_row = 0;              // top left position
+		int m_col = 0;
+		int m_rowSpan = 1;
+		int m_colSpan = 1;
+	};
+
+	int Build( const Table & tbl );
+	void Clear();
+
+	int GetRowNum() const { return m_rowNum; }
+	int GetColNum() const { return m_colNum; }
+	// cell cover ( row, col ), nullptr if out of range or no cell ( short row )
+	const CellInfo * GetOwner( int row, int col ) const;
+	TCell GetCell( int row, int col ) const { const CellInfo * info = GetOwner( row, col ); return info ? info->m_cell : TCell( Element() ); }
+	// owner of cell, vmerge continue cell return its start cell, nullptr if cell not in table
+	const CellInfo * Find( const TCell & cell ) const;
+	// all owner cell in row by row order
+	const std::vector<CellInfo> & GetAllCell() const { return m_cells; }
+
+private:
+	int m_rowNum = 0;
+	int m_colNum = 0;
+	std::vector<CellInfo> m_cells;
+	std::vector<int> m_grid;  // m_rowNum * m_colNum index of m_cells, -1 if no cell
+	std::unordered_map< const pugi::xml_node_struct *, int > m_cellIdx;  // every w:tc to index of m_cells
+};
+
+// one column of TableColumns, text of all rows in one arena
+class SPD_API ColumnData
+{
+public:
+	std::vector<char> m_data;         // utf-8 text of every row, no '\0', paragraphs in cell joined by '\n'
+	std::vector<uint32_t> m_offset;   // row num + 1, text of row i is [ m_offset[i], m_offset[i + 1] )
+	std::vector<uint8_t> m_covered;   // row num, 1 if position is covered by merged cell of other position, text is empty
+
+	std::string_view Get( int row ) const { return std::string_view( m_data.data() + m_offset[row], m_offset[row + 1] - m_offset[row] ); }
+	void Clear() { m_data.clear(); m_offset.clear(); m_covered.clear(); }  // keep capacity for reuse
+};
+
+// merged cell, top left position and size
+class SPD_API MergeRange
+{
+public:
+	int m_row = 0;
+	int m_col = 0;
+	int m_rowSpan = 1;
+	int m_colSpan = 1;
+};
+
+// table content in column layout, for bulk analysis without per cell allocation
+class SPD_API TableColumns
+{
+public:
+	int m_parent = -1;  // index of outer table in Document::ExtractTables(), -1 if top level
+	int m_rowNum = 0;
+	int m_colNum = 0;
+	std::vector<ColumnData> m_cols;
+	std::vector<MergeRange> m_merges;  // only cell with rowSpan or colSpan > 1
+};
+
+// append many row to the end of a Table by clone a prototype row, ex :
+//   TRowAppender app; app.Init( tbl, tbl.GetFirstChild() );
+//   for( ... ) app.Append( { name, price, count } );
+// prototype keep row / cell / paragraph / run property, each cell keep one paragraph with one run,
+// w14:paraId / w14:textId and vMerge are removed. Table should not be deleted while appending
+class SPD_API TRowAppender
+{
+public:
+	TRowAppender() { }
+	TRowAppender( const TRowAppender & ) = delete;
+	TRowAppender & operator = ( const TRowAppender & ) = delete;
+
+	int Init( const Table & tbl, const TRow & proto );
+	int GetCellNum() const { return (int)m_cellPos.size(); }
+	// values[i] is text of cell i, missing or more values are ignored, return INVALID if not init
+	TRow Append( const std::string_view * values, size_t num );
+	TRow Append( const std::vector<std::string_view> & values ) { return Append( values.data(), values.size() ); }
+	TRow Append( std::initializer_list<std::string_view> values ) { return Append( values.begin(), values.size() ); }
+
+private:
+	Table m_tbl{ Element() };
+	pugi::xml_document m_proto;      // sanitized prototype row
+	std::vector<int> m_cellPos;      // child position of each w:tc in row
+	std::vector<int> m_textPos;      // child position of w:p in w:tc, w:r in w:p and w:t in w:r, 3 for each cell
+};
+
+// handle subclass only add method, no member and no virtual, so slicing to / from Element is safe
+static_assert( std::is_trivially_copyable<Element>::value, "Element should be trivially copyable" );
+static_assert( sizeof(Element) <= 16, "Element should be small value" );
+static_assert( std::is_trivially_copyable<Paragraph>::value && sizeof(Paragraph) == sizeof(Element), "Paragraph should not add member" );
+static_assert( std::is_trivially_copyable<Hyperlink>::value && sizeof(Hyperlink) == sizeof(Element), "Hyperlink should not add member" );
+static_assert( std::is_trivially_copyable<Run>::value && sizeof(Run) == sizeof(Element), "Run should not add member" );
+static_assert( std::is_trivially_copyable<Table>::value && sizeof(Table) == sizeof(Element), "Table should not add member" );
+static_assert( std::is_trivially_copyable<TRow>::value && sizeof(TRow) == sizeof(Element), "TRow should not add member" );
+static_assert( std::is_trivially_copyable<TCell>::value && sizeof(TCell) == sizeof(Element), "TCell should not add member" );
+
+// compile time tag filter for typed child range, w:r also need check child
+template< class T > struct ElementTraits;
+template<> struct ElementTraits<Paragraph> { static constexpr TagIdE TAG = TagIdE::W_P; static constexpr ElementTypeE TYPE = ElementTypeE::PARAGRAPH; };
+template<> struct ElementTraits<Hyperlink> { static constexpr TagIdE TAG = TagIdE::W_HYPERLINK; static constexpr ElementTypeE TYPE = ElementTypeE::HYPERLINK; };
+template<> struct ElementTraits<Run> { static constexpr TagIdE TAG = TagIdE::W_R; static constexpr ElementTypeE TYPE = ElementTypeE::RUN; };
+template<> struct ElementTraits<Table> { static constexpr TagIdE TAG = TagIdE::W_TBL; static constexpr ElementTypeE TYPE = ElementTypeE::TABLE; };
+template<> struct ElementTraits<TRow> { static constexpr TagIdE TAG = TagIdE::W_TR; static constexpr ElementTypeE TYPE = ElementTypeE::TABLE_ROW; };
+template<> struct ElementTraits<TCell> { static constexpr TagIdE TAG = TagIdE::W_TC; static constexpr ElementTypeE TYPE = ElementTypeE::TABLE_CELL; };
+
+// forward iterator over sibling of type T, other sibling is skipped by tag id without classify
+template< class T >
+class TypedElementIterator
+{
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const T *;
+	using reference = const T &;
+
+	TypedElementIterator() : m_ele( Element() ) { }
+
+	bool operator == ( const TypedElementIterator & it ) const { return m_ele.m_nd == it.m_ele.m_nd; }
+	bool operator != ( const TypedElementIterator & it ) const { return m_ele.m_nd != it.m_ele.m_nd; }
+
+	TypedElementIterator & operator ++ () { m_ele = T( make( m_ele.m_nd.next_sibling() ) ); return *this; }
+	TypedElementIterator operator ++ ( int ) { auto tmp = *this; ++*this; return tmp; }
+
+	const T & operator * () const { return m_ele; }
+	const T * operator -> () const { return &m_ele; }
+
+private:
+	template< class U > friend class TypedElementRange;
+	explicit TypedElementIterator( pugi::xml_node nd ) : m_ele( make( nd ) ) { }
+
+	static Element make( pugi::xml_node nd )
+	{
+		for( ; !nd.empty(); nd = nd.next_sibling() ) {
+			if( Element::GetTagId( nd ) != ElementTraits<T>::TAG )
+				continue;
+			if( ElementTraits<T>::TAG == TagIdE::W_R && Element::get_tag_type( nd, TagIdE::W_R ) != ElementTypeE::RUN )
+				continue;
+			return Element( nd, ElementTraits<T>::TYPE );
+		}
+		return Element();
+	}
+
+	T m_ele;
+};
+
+template< class T >
+class TypedElementRange
+{
+public:
+	using iterator = TypedElementIterator<T>;
+	using const_iterator = TypedElementIterator<T>;
+
+	iterator begin() const { return iterator( m_first ); }
+	iterator end() const { return iterator(); }
+	bool empty() const { return begin() == end(); }
+
+private:
+	friend class Element;
+	friend class Document;
+	explicit TypedElementRange( pugi::xml_node first ) : m_first( first ) { }
+
+	pugi::xml_node m_first;  // first child node, not filtered yet
+};
+
+template< class T > 
+inline TypedElementRange<T> Element::Children() const
+{
+	if( m_type == ElementTypeE::INVALID || m_type == ElementTypeE::UNKNOWN )
+		return TypedElementRange<T>( pugi::xml_node() );
+	return TypedElementRange<T>( m_nd.first_child() );
+}
+
 ////////////////////////////////
 END_NS_SPD
 
@@ -0,0 +1,604 @@
+// SPD_Index.cpp : spdocx persistent full text index
+// Copyright (C) 2021 ~ 2025 drangon <drangon_zhou (at) hotmail.com>
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+#include "SPD_Index.h"
+#include "SPD_Document.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h> // strtol
+#include <string.h> // memcmp
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#endif
+
+BEGIN_NS_SPD
+////////////////////////////////
+
+static const char g_SegMagic[4] = { 'S', 'P', 'D', 'I' };
+static const uint32_t SEG_VERSION = 2;  // 2 : utf-8 tokenizer
+static const size_t SEG_HEAD_LEN = 48;
+static const size_t SEG_TERM_LEN = 32;
+
+static void put_u32( std::vector<uint8_t> & buf, uint32_t v )
+{
+	for( int i = 0; i < 4; ++i )
+		buf.push_back( (uint8_t)( v >> ( i * 8 ) ) );
+}
+
+static void put_u64( std::vector<uint8_t> & buf, uint64_t v )
+{
+	for( int i = 0; i < 8; ++i )
+		buf.push_back( (uint8_t)( v >> ( i * 8 ) ) );
+}
+
+static void put_varint( std::vector<uint8_t> & buf, uint32_t v )
+{
+	while( v >= 0x80 ) {
+		buf.push_back( (uint8_t)( v | 0x80 ) );
+		v >>= 7;
+	}
+	buf.push_back( (uint8_t)v );
+}
+
+static uint32_t get_u32( const uint8_t * p )
+{
+	return (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) | ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+static uint64_t get_u64( const uint8_t * p )
+{
+	return (uint64_t)get_u32( p ) | ( (uint64_t)get_u32( p + 4 ) << 32 );
+}
+
+// return false if overflow end or too long
+static bool get_varint( const uint8_t * & p, const uint8_t * end, uint32_t & v )
+{
+	v = 0;
+	for( int shift = 0; shift < 35 && p < end; shift += 7 ) {
+		uint8_t c = *p++;
+		v |= (uint32_t)( c & 0x7F ) << shift;
+		if( ( c & 0x80 ) == 0 )
+			return true;
+	}
+	return false;
+}
+
+int IndexWriter::AddFile( const std::string & fname )
+{
+	Document doc;
+	int ret = doc.Open( fname );
+	if( ret < 0 )
+		return ret;
+	return AddDocument( fname, doc );
+}
+
+int IndexWriter::AddDocument( const std::string & name, const Document & doc )
+{
+	uint32_t docid = (uint32_t)m_docs.size();
+	m_docs.push_back( name );
+	int count = doc.GetElementCount();
+	for( int i = 0; i < count; ++i ) {
+		Element ele = doc.GetElementAt( i );
+		uint32_t pos = 0;
+		if( ele.GetType() == ElementTypeE::PARAGRAPH ) {
+			m_text.clear();
+			Paragraph( ele ).GetText( m_text );
+			add_text( docid, (uint32_t)i, m_text, pos );
+		}
+		else if( ele.GetType() == ElementTypeE::TABLE ) {
+			// position is continued in whole table, one empty position after each cell
+			// so phrase never match across cell boundary
+			for( TRow row : Table( ele ).Children<TRow>() ) {
+				for( TCell cell : row.Children<TCell>() ) {
+					m_text.clear();
+					cell.GetText( m_text );
+					add_text( docid, (uint32_t)i, m_text, pos );
+					++pos;
+				}
+			}
+		}
+	}
+	return (int)docid;
+}
+
+void IndexWriter::add_text( uint32_t doc, uint32_t elem, std::string_view text, uint32_t & pos )
+{
+	IndexTokenizer::ForEach( text, [&]( std::string_view token ) {
+		add_hit( token, doc, elem, pos );
+		++pos;
+	} );
+	return;
+}
+
+void IndexWriter::add_hit( std::string_view term, uint32_t doc, uint32_t elem, uint32_t pos )
+{
+	m_key.assign( term.data(), term.size() );
+	auto it = m_post.find( m_key );
+	if( it == m_post.end() )
+		it = m_post.emplace( m_key, Posting() ).first;
+	Posting & p = it->second;
+	if( p.m_hitNum == 0 || doc != p.m_doc ) {
+		put_varint( p.m_data, doc - p.m_doc );
+		put_varint( p.m_data, elem );
+		put_varint( p.m_data, pos );
+		p.m_docFreq += 1;
+	}
+	else {
+		put_varint( p.m_data, 0 );
+		put_varint( p.m_data, elem - p.m_elem );
+		put_varint( p.m_data, ( elem == p.m_elem ) ? pos - p.m_pos : pos );
+	}
+	p.m_hitNum += 1;
+	p.m_doc = doc;
+	p.m_elem = elem;
+	p.m_pos = pos;
+	return;
+}
+
+void IndexWriter::Clear()
+{
+	m_docs.clear();
+	m_post.clear();
+	return;
+}
+
+int IndexWriter::Commit( const std::string & dir )
+{
+#ifdef _WIN32
+	::CreateDirectoryA( dir.c_str(), nullptr );
+#else
+	mkdir( dir.c_str(), 0755 );
+#endif
+	std::vector<int> segs;
+	if( IndexReader::ListSegment( dir, segs ) < 0 ) {
+		SPD_PR_INFO( "index dir [%s] can not read", dir.c_str() );
+		return SPD_ERR_SAVE_INDEX;
+	}
+	int segno = segs.empty() ? 1 : segs.back() + 1;
+
+	// term in sorted order, posting is written after all fixed part
+	std::vector< const std::pair<const std::string, Posting> * > terms;
+	terms.reserve( m_post.size() );
+	for( const auto & kv : m_post )
+		terms.push_back( &kv );
+	std::sort( terms.begin(), terms.end(), []( const auto * a, const auto * b ) { return a->first < b->first; } );
+
+	std::vector<uint8_t> buf;
+	uint64_t docLen = 4 * ( m_docs.size() + 1 );
+	for( const std::string & name : m_docs )
+		docLen += name.size();
+	uint64_t strLen = 0;
+	for( const auto * t : terms )
+		strLen += t->first.size();
+	if( docLen > UINT32_MAX || strLen > UINT32_MAX || m_docs.size() > UINT32_MAX ) {
+		SPD_PR_INFO( "index segment too large, %d docs", (int)m_docs.size() );
+		return SPD_ERR_SAVE_INDEX;
+	}
+	uint64_t docOff = SEG_HEAD_LEN;
+	uint64_t termOff = docOff + docLen;
+	uint64_t termStrOff = termOff + SEG_TERM_LEN * terms.size();
+	uint64_t postOff = termStrOff + strLen;
+
+	buf.insert( buf.end(), g_SegMagic, g_SegMagic + 4 );
+	put_u32( buf, SEG_VERSION );
+	put_u32( buf, (uint32_t)m_docs.size() );
+	put_u32( buf, (uint32_t)terms.size() );
+	put_u64( buf, docOff );
+	put_u64( buf, termOff );
+	put_u64( buf, termStrOff );
+	put_u64( buf, postOff );
+
+	uint32_t off = 0;
+	for( const std::string & name : m_docs ) {
+		put_u32( buf, off );
+		off += (uint32_t)name.size();
+	}
+	put_u32( buf, off );
+	for( const std::string & name : m_docs )
+		buf.insert( buf.end(), name.begin(), name.end() );
+
+	uint64_t poff = 0;
+	off = 0;
+	for( const auto * t : terms ) {
+		const Posting & p = t->second;
+		put_u64( buf, poff );
+		put_u32( buf, (uint32_t)p.m_data.size() );
+		put_u32( buf, off );
+		put_u32( buf, (uint32_t)t->first.size() );
+		put_u32( buf, p.m_docFreq );
+		put_u32( buf, p.m_hitNum );
+		put_u32( buf, 0 );
+		poff += p.m_data.size();
+		off += (uint32_t)t->first.size();
+	}
+	for( const auto * t : terms )
+		buf.insert( buf.end(), t->first.begin(), t->first.end() );
+
+	// write to unique temp, then claim next free segment name by exclusive link, reader never see partial
+	// segment and concurrent writer of same dir never overwrite each other
+	std::string tmpname;
+	FILE * fp = nullptr;
+#ifdef _WIN32
+	char tmpbuf[MAX_PATH];
+	if( ::GetTempFileNameA( dir.c_str(), "spd", 0, tmpbuf ) != 0 ) {
+		tmpname = tmpbuf;
+		fp = fopen( tmpname.c_str(), "wb" );
+	}
+#else
+	tmpname = dir + "/tmp_XXXXXX";
+	int fd = mkstemp( &tmpname[0] );
+	if( fd >= 0 ) {
+		fchmod( fd, 0644 );
+		fp = fdopen( fd, "wb" );
+		if( fp == nullptr )
+			close( fd );
+	}
+#endif // _WIN32
+	if( fp == nullptr ) {
+		SPD_PR_INFO( "create temp segment in [%s] failed", dir.c_str() );
+		if( !tmpname.empty() )
+			remove( tmpname.c_str() );
+		return SPD_ERR_SAVE_INDEX;
+	}
+	bool ok = ( fwrite( buf.data(), 1, buf.size(), fp ) == buf.size() );
+	for( size_t i = 0; ok && i < terms.size(); ++i ) {
+		const std::vector<uint8_t> & data = terms[i]->second.m_data;
+		ok = ( fwrite( data.data(), 1, data.size(), fp ) == data.size() );
+	}
+	if( fclose( fp ) != 0 )
+		ok = false;
+	std::string fname;
+	for( ; ok; ++segno ) {
+		if( segno > 999999 ) {
+			ok = false;
+			break;
+		}
+		fname = IndexReader::GetSegmentName( dir, segno );
+#ifdef _WIN32
+		if( ::MoveFileExA( tmpname.c_str(), fname.c_str(), 0 ) )
+			break;
+		DWORD err = ::GetLastError();
+		ok = ( err == ERROR_ALREADY_EXISTS || err == ERROR_FILE_EXISTS );
+#else
+		if( link( tmpname.c_str(), fname.c_str() ) == 0 ) {
+			unlink( tmpname.c_str() );
+			break;
+		}
+		ok = ( errno == EEXIST );
+#endif // _WIN32
+	}
+	if( !ok ) {
+		SPD_PR_INFO( "write index segment of [%s] failed", dir.c_str() );
+		remove( tmpname.c_str() );
+		return SPD_ERR_SAVE_INDEX;
+	}
+	SPD_PR_DEBUG( "index segment [%s] %d docs, %d terms, %d bytes", fname.c_str(), (int)m_docs.size(), (int)terms.size(), (int)( postOff + poff ) );
+	Clear();
+	return segno;
+}
+
+std::string IndexReader::GetSegmentName( const std::string & dir, int seg )
+{
+	char name[32];
+	snprintf( name, sizeof( name ), "seg_%06d.spdi", seg );
+	return dir + "/" + name;
+}
+
+// seg no of "seg_NNNNNN.spdi", -1 if not segment name
+static int parse_segment_name( const char * name )
+{
+	if( strncmp( name, "seg_", 4 ) != 0 )
+		return -1;
+	char * end = nullptr;
+	long no = strtol( name + 4, &end, 10 );
+	if( end == name + 4 || strcmp( end, ".spdi" ) != 0 || no <= 0 || no > 999999 )
+		return -1;
+	return (int)no;
+}
+
+int IndexReader::ListSegment( const std::string & dir, std::vector<int> & segs )
+{
+	segs.clear();
+#ifdef _WIN32
+	WIN32_FIND_DATAA fd;
+	HANDLE h = ::FindFirstFileA( ( dir + "\\seg_*.spdi" ).c_str(), &fd );
+	if( h == INVALID_HANDLE_VALUE )
+		return ( ::GetLastError() == ERROR_FILE_NOT_FOUND ) ? 0 : SPD_ERR_OPEN_INDEX;
+	do {
+		int no = parse_segment_name( fd.cFileName );
+		if( no > 0 )
+			segs.push_back( no );
+	} while( ::FindNextFileA( h, &fd ) );
+	::FindClose( h );
+#else
+	DIR * d = opendir( dir.c_str() );
+	if( d == nullptr )
+		return ( errno == ENOENT ) ? 0 : SPD_ERR_OPEN_INDEX;
+	for( struct dirent * ent = readdir( d ); ent != nullptr; ent = readdir( d ) ) {
+		int no = parse_segment_name( ent->d_name );
+		if( no > 0 )
+			segs.push_back( no );
+	}
+	closedir( d );
+#endif // _WIN32
+	std::sort( segs.begin(), segs.end() );
+	return (int)segs.size();
+}
+
+int IndexReader::map_segment( const std::string & fname, Segment & seg )
+{
+#ifdef _WIN32
+	HANDLE fh = ::CreateFileA( fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if( fh == INVALID_HANDLE_VALUE )
+		return SPD_ERR_OPEN_INDEX;
+	LARGE_INTEGER size;
+	if( !::GetFileSizeEx( fh, &size ) || size.QuadPart == 0 ) {
+		::CloseHandle( fh );
+		return SPD_ERR_OPEN_INDEX;
+	}
+	HANDLE mh = ::CreateFileMappingA( fh, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	::CloseHandle( fh );  // mapping keep the file
+	if( mh == nullptr )
+		return SPD_ERR_OPEN_INDEX;
+	void * data = ::MapViewOfFile( mh, FILE_MAP_READ, 0, 0, 0 );
+	if( data == nullptr ) {
+		::CloseHandle( mh );
+		return SPD_ERR_OPEN_INDEX;
+	}
+	seg.m_data = (const uint8_t *)data;
+	seg.m_size = (size_t)size.QuadPart;
+	seg.m_mapping = mh;
+#else
+	int fd = open( fname.c_str(), O_RDONLY | O_CLOEXEC );
+	if( fd < 0 ) {
+		SPD_PR_INFO( "open() [%s] failed, err %d", fname.c_str(), errno );
+		return SPD_ERR_OPEN_INDEX;
+	}
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+		close( fd );
+		return SPD_ERR_OPEN_INDEX;
+	}
+	void * data = mmap( nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );  // mapping keep the file
+	if( data == MAP_FAILED ) {
+		SPD_PR_INFO( "mmap() [%s] failed, err %d", fname.c_str(), errno );
+		return SPD_ERR_OPEN_INDEX;
+	}
+	seg.m_data = (const uint8_t *)data;
+	seg.m_size = (size_t)st.st_size;
+#endif // _WIN32
+	return SPD_ERR_OK;
+}
+
+void IndexReader::unmap_segment( Segment & seg )
+{
+	if( seg.m_data == nullptr )
+		return;
+#ifdef _WIN32
+	::UnmapViewOfFile( seg.m_data );
+	::CloseHandle( (HANDLE)seg.m_mapping );
+#else
+	munmap( (void *)seg.m_data, seg.m_size );
+#endif // _WIN32
+	seg.m_data = nullptr;
+	seg.m_size = 0;
+	seg.m_mapping = nullptr;
+	return;
+}
+
+int IndexReader::check_segment( Segment & seg )
+{
+	const uint8_t * p = seg.m_data;
+	if( seg.m_size < SEG_HEAD_LEN || memcmp( p, g_SegMagic, 4 ) != 0 || get_u32( p + 4 ) != SEG_VERSION )
+		return SPD_ERR_OPEN_INDEX;
+	seg.m_docNum = get_u32( p + 8 );
+	seg.m_termNum = get_u32( p + 12 );
+	seg.m_docOff = get_u64( p + 16 );
+	seg.m_termOff = get_u64( p + 24 );
+	seg.m_termStrOff = get_u64( p + 32 );
+	seg.m_postOff = get_u64( p + 40 );
+	// section is in order, fixed size part must fit
+	if( seg.m_docOff != SEG_HEAD_LEN || seg.m_termOff < seg.m_docOff + 4 * ( (uint64_t)seg.m_docNum + 1 )
+			|| seg.m_termStrOff != seg.m_termOff + SEG_TERM_LEN * (uint64_t)seg.m_termNum
+			|| seg.m_postOff < seg.m_termStrOff || seg.m_postOff > seg.m_size )
+		return SPD_ERR_OPEN_INDEX;
+	// posting of last term end at file end, catch truncated or appended file
+	uint64_t postEnd = seg.m_postOff;
+	if( seg.m_termNum > 0 ) {
+		const uint8_t * e = p + seg.m_termOff + SEG_TERM_LEN * ( (uint64_t)seg.m_termNum - 1 );
+		postEnd += get_u64( e ) + get_u32( e + 8 );
+	}
+	if( postEnd != seg.m_size )
+		return SPD_ERR_OPEN_INDEX;
+	return SPD_ERR_OK;
+}
+
+int IndexReader::Open( const std::string & dir )
+{
+	Close();
+	std::vector<int> segs;
+	int ret = ListSegment( dir, segs );
+	if( ret < 0 )
+		return ret;
+	for( int no : segs ) {
+		std::string fname = GetSegmentName( dir, no );
+		Segment seg;
+		ret = map_segment( fname, seg );
+		if( ret == SPD_ERR_OK ) {
+			ret = check_segment( seg );
+			if( ret != SPD_ERR_OK )
+				unmap_segment( seg );
+		}
+		if( ret != SPD_ERR_OK ) {
+			SPD_PR_INFO( "index segment [%s] invalid", fname.c_str() );
+			Close();
+			return ret;
+		}
+		seg.m_docBase = m_docNum;
+		m_docNum += seg.m_docNum;
+		m_segs.push_back( seg );
+	}
+	// name of first indexed doc win
+	m_docIdx.reserve( m_docNum );
+	for( uint32_t i = 0; i < m_docNum; ++i )
+		m_docIdx.emplace( GetDocName( i ), i );
+	return (int)m_segs.size();
+}
+
+void IndexReader::Close()
+{
+	for( Segment & seg : m_segs )
+		unmap_segment( seg );
+	m_segs.clear();
+	m_docNum = 0;
+	m_docIdx.clear();
+	return;
+}
+
+std::string_view IndexReader::GetDocName( uint32_t doc ) const
+{
+	for( const Segment & seg : m_segs ) {
+		if( doc < seg.m_docBase || doc >= seg.m_docBase + seg.m_docNum )
+			continue;
+		const uint8_t * offs = seg.m_data + seg.m_docOff;
+		uint32_t local = doc - seg.m_docBase;
+		uint64_t names = seg.m_docOff + 4 * ( (uint64_t)seg.m_docNum + 1 );
+		uint32_t begin = get_u32( offs + 4 * local );
+		uint32_t end = get_u32( offs + 4 * ( local + 1 ) );
+		if( begin > end || names + end > seg.m_termOff )
+			return std::string_view();
+		return std::string_view( (const char *)seg.m_data + names + begin, end - begin );
+	}
+	return std::string_view();
+}
+
+int IndexReader::FindDoc( std::string_view name ) const
+{
+	auto it = m_docIdx.find( name );
+	return ( it != m_docIdx.end() ) ? (int)it->second : -1;
+}
+
+int IndexReader::find_segment( const Segment & seg, std::string_view term, std::vector<IndexHit> & hits ) const
+{
+	const uint8_t * terms = seg.m_data + seg.m_termOff;
+	auto term_str = [&]( uint32_t i ) {
+		const uint8_t * e = terms + SEG_TERM_LEN * i;
+		uint64_t off = seg.m_termStrOff + get_u32( e + 12 );
+		uint32_t len = get_u32( e + 16 );
+		if( off + len > seg.m_postOff )
+			return std::string_view();
+		return std::string_view( (const char *)seg.m_data + off, len );
+	};
+	// binary search in sorted term
+	uint32_t lo = 0, hi = seg.m_termNum;
+	while( lo < hi ) {
+		uint32_t mid = lo + ( hi - lo ) / 2;
+		if( term_str( mid ) < term )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if( lo >= seg.m_termNum || term_str( lo ) != term )
+		return 0;
+
+	const uint8_t * e = terms + SEG_TERM_LEN * lo;
+	uint64_t off = seg.m_postOff + get_u64( e );
+	uint32_t len = get_u32( e + 8 );
+	uint32_t hitnum = get_u32( e + 24 );
+	if( off + len > seg.m_size )
+		return SPD_ERR_OPEN_INDEX;
+	const uint8_t * p = seg.m_data + off;
+	const uint8_t * end = p + len;
+	IndexHit hit{ 0, 0, 0 };
+	for( uint32_t i = 0; i < hitnum; ++i ) {
+		uint32_t ddoc, delem, dpos;
+		if( !get_varint( p, end, ddoc ) || !get_varint( p, end, delem ) || !get_varint( p, end, dpos ) )
+			return SPD_ERR_OPEN_INDEX;
+		if( i == 0 || ddoc > 0 ) {
+			hit.m_doc += ddoc;
+			hit.m_elem = delem;
+			hit.m_pos = dpos;
+		}
+		else if( delem > 0 ) {
+			hit.m_elem += delem;
+			hit.m_pos = dpos;
+		}
+		else {
+			hit.m_pos += dpos;
+		}
+		hits.push_back( IndexHit{ seg.m_docBase + hit.m_doc, hit.m_elem, hit.m_pos } );
+	}
+	return (int)hitnum;
+}
+
+int IndexReader::Find( std::string_view term, std::vector<IndexHit> & hits ) const
+{
+	hits.clear();
+	for( const Segment & seg : m_segs ) {
+		int ret = find_segment( seg, term, hits );
+		if( ret < 0 )
+			return ret;
+	}
+	return (int)hits.size();
+}
+
+int IndexReader::Query( std::string_view text, std::vector<IndexHit> & hits ) const
+{
+	std::vector<std::string> tokens;
+	IndexTokenizer::ForEach( text, [&tokens]( std::string_view token ) { tokens.emplace_back( token ); } );
+	hits.clear();
+	if( tokens.empty() )
+		return 0;
+	int ret = Find( tokens[0], hits );
+	if( ret <= 0 )
+		return ret;
+
+	// keep hit followed by every next token, hit list is sorted
+	auto less = []( const IndexHit & a, const IndexHit & b ) {
+		return a.m_doc != b.m_doc ? a.m_doc < b.m_doc : ( a.m_elem != b.m_elem ? a.m_elem < b.m_elem : a.m_pos < b.m_pos );
+	};
+	std::vector<IndexHit> next;
+	for( size_t i = 1; i < tokens.size() && !hits.empty(); ++i ) {
+		ret = Find( tokens[i], next );
+		if( ret < 0 )
+			return ret;
+		size_t num = 0;
+		for( const IndexHit & h : hits ) {
+			IndexHit want{ h.m_doc, h.m_elem, h.m_pos + (uint32_t)i };
+			if( std::binary_search( next.begin(), next.end(), want, less ) )
+				hits[num++] = h;
+		}
+		hits.resize( num );
+	}
+	return (int)hits.size();
+}
+
+////////////////////////////////
+END_NS_SPD
@@ -0,0 +1,298 @@
+// SPD_Index.h : spdocx persistent full text index
+// Copyright (C) 2021 ~ 2025 drangon <drangon_zhou (at) hotmail.com>
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+#ifndef INCLUDED_SPD_INDEX_H
+#define INCLUDED_SPD_INDEX_H
+
+#include "SPD_Common.h"
+#include "SPD_Element.h"
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+BEGIN_NS_SPD
+////////////////////////////////
+
+class Document;
+
+// index directory is a list of immutable segment "seg_NNNNNN.spdi", each IndexWriter::Commit() add one segment
+// ( next free no is claimed exclusively, concurrent writer is safe ),
+// doc id is global in segment order. segment layout ( little endian ) :
+//   header   : "SPDI", u32 version, u32 docNum, u32 termNum, u64 docOff, u64 termOff, u64 termStrOff, u64 postOff
+//   doc      : u32 nameOff[docNum + 1], name bytes
+//   term     : { u64 postOff, u32 postLen, u32 strOff, u32 strLen, u32 docFreq, u32 hitNum, u32 0 } [termNum] sorted by term
+//   termStr  : term bytes
+//   posting  : varint hit of each term, ( docDelta, elem, pos ) for first hit of doc, else ( 0, elemDelta, pos ) or ( 0, 0, posDelta )
+
+// one hit of term : document, top level Element ordinal ( Document::GetElementAt() ), token position in Element
+// ( table cell text is continued in the table, with one empty position after each cell )
+class SPD_API IndexHit
+{
+public:
+	uint32_t m_doc;
+	uint32_t m_elem;
+	uint32_t m_pos;
+};
+
+// token is run of letter / digit in utf-8, ascii / latin-1 / greek / cyrillic / fullwidth ascii is lower case,
+// space and punctuation split token ( ascii, U+0080 - U+00BF, U+2000 - U+2BFF, U+3000 - U+303F, fullwidth ... ),
+// each CJK ideograph / kana is one token, phrase of them is matched by position
+class SPD_API IndexTokenizer
+{
+public:
+	static const size_t MAX_TOKEN_LEN = 64;  // longer token is cut at char boundary
+
+	// func( std::string_view token ) for each token, token is valid only in callback
+	template< class F > static void ForEach( std::string_view text, F func );
+
+private:
+	enum class CharE : uint8_t
+	{
+		SPLIT,
+		WORD,
+		SINGLE,  // one char token
+	};
+	static uint32_t decode( const uint8_t * p, size_t size, size_t & len );  // bad sequence is U+FFFD of one byte
+	static uint32_t fold( uint32_t cp );
+	static CharE classify( uint32_t cp );
+	static size_t encode( uint32_t cp, char * out );
+};
+
+// collect posting of documents in memory, then write as a new segment
+class SPD_API IndexWriter
+{
+public:
+	IndexWriter() { }
+	IndexWriter( const IndexWriter & ) = delete;
+	IndexWriter & operator = ( const IndexWriter & ) = delete;
+
+	int AddFile( const std::string & fname );  // open docx and add with fname, return doc index in this writer
+	int AddDocument( const std::string & name, const Document & doc );  // paragraph and table cell text
+	int GetDocNum() const { return (int)m_docs.size(); }
+	// write added document as next free segment of dir ( created if not exist ), then clear, return segment no
+	int Commit( const std::string & dir );
+	void Clear();
+
+private:
+	class Posting
+	{
+	public:
+		std::vector<uint8_t> m_data;  // varint hit
+		uint32_t m_docFreq = 0;
+		uint32_t m_hitNum = 0;
+		uint32_t m_doc = 0;  // last hit
+		uint32_t m_elem = 0;
+		uint32_t m_pos = 0;
+	};
+
+	void add_text( uint32_t doc, uint32_t elem, std::string_view text, uint32_t & pos );
+	void add_hit( std::string_view term, uint32_t doc, uint32_t elem, uint32_t pos );
+
+	std::vector<std::string> m_docs;
+	std::unordered_map<std::string, Posting> m_post;
+	std::string m_key;   // reused lookup key
+	std::string m_text;  // reused Element text
+};
+
+// map all segment of index directory read only, const method is thread safe after Open()
+class SPD_API IndexReader
+{
+public:
+	IndexReader() { }
+	~IndexReader() { Close(); }
+	IndexReader( const IndexReader & ) = delete;
+	IndexReader & operator = ( const IndexReader & ) = delete;
+
+	int Open( const std::string & dir );  // return segment num, 0 if dir has no segment
+	void Close();
+
+	int GetSegmentNum() const { return (int)m_segs.size(); }
+	int GetDocNum() const { return (int)m_docNum; }
+	std::string_view GetDocName( uint32_t doc ) const;  // empty if out of range
+	int FindDoc( std::string_view name ) const;  // doc id, -1 if not indexed
+
+	// hit of one token ( lower case ), sorted by doc, elem, pos. return hit num, or < 0 if segment corrupted
+	int Find( std::string_view term, std::vector<IndexHit> & hits ) const;
+	// all token of text at consecutive position in same Element, hit is the first token
+	int Query( std::string_view text, std::vector<IndexHit> & hits ) const;
+
+	// list segment no of dir in ascending order
+	static int ListSegment( const std::string & dir, std::vector<int> & segs );
+	static std::string GetSegmentName( const std::string & dir, int seg );
+
+private:
+	class Segment
+	{
+	public:
+		const uint8_t * m_data = nullptr;
+		size_t m_size = 0;
+		void * m_mapping = nullptr;  // platform handle of mapping
+		uint32_t m_docBase = 0;
+		uint32_t m_docNum = 0;
+		uint32_t m_termNum = 0;
+		uint64_t m_docOff = 0;
+		uint64_t m_termOff = 0;
+		uint64_t m_termStrOff = 0;
+		uint64_t m_postOff = 0;
+	};
+
+	static int map_segment( const std::string & fname, Segment & seg );
+	static void unmap_segment( Segment & seg );
+	static int check_segment( Segment & seg );
+	int find_segment( const Segment & seg, std::string_view term, std::vector<IndexHit> & hits ) const;
+
+	std::vector<Segment> m_segs;
+	uint32_t m_docNum = 0;
+	std::unordered_map<std::string_view, uint32_t> m_docIdx;  // doc name -> id, build by Open()
+};
+
+inline uint32_t IndexTokenizer::decode( const uint8_t * p, size_t size, size_t & len )
+{
+	uint32_t c = p[0];
+	len = 1;
+	if( c < 0x80 )
+		return c;
+	size_t n = ( c >= 0xF0 && c < 0xF5 ) ? 4 : ( c >= 0xE0 ) ? 3 : ( c >= 0xC2 ) ? 2 : 0;
+	if( n == 0 || n > size || c >= 0xF5 )
+		return 0xFFFD;
+	uint32_t cp = c & ( 0x7F >> n );
+	for( size_t i = 1; i < n; ++i ) {
+		if( ( p[i] & 0xC0 ) != 0x80 )
+			return 0xFFFD;
+		cp = ( cp << 6 ) | ( p[i] & 0x3F );
+	}
+	if( ( n == 3 && cp < 0x800 ) || ( n == 4 && ( cp < 0x10000 || cp > 0x10FFFF ) ) || ( cp >= 0xD800 && cp < 0xE000 ) )
+		return 0xFFFD;
+	len = n;
+	return cp;
+}
+
+inline uint32_t IndexTokenizer::fold( uint32_t cp )
+{
+	if( cp >= 'A' && cp <= 'Z' )
+		return cp + 0x20;
+	if( cp < 0xC0 )
+		return cp;
+	if( cp <= 0xDE && cp != 0xD7 )  // latin-1
+		return cp + 0x20;
+	if( cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2 )  // greek
+		return cp + 0x20;
+	if( cp >= 0x400 && cp <= 0x40F )  // cyrillic
+		return cp + 0x50;
+	if( cp >= 0x410 && cp <= 0x42F )
+		return cp + 0x20;
+	if( cp >= 0xFF01 && cp <= 0xFF5E )  // fullwidth ascii
+		return fold( cp - 0xFEE0 );
+	return cp;
+}
+
+inline IndexTokenizer::CharE IndexTokenizer::classify( uint32_t cp )
+{
+	if( cp < 0x80 )
+		return ( ( cp | 0x20 ) >= 'a' && ( cp | 0x20 ) <= 'z' ) || ( cp >= '0' && cp <= '9' ) ? CharE::WORD : CharE::SPLIT;
+	if( cp < 0xC0 || cp == 0xD7 || cp == 0xF7 )  // c1 control, nbsp, latin-1 punctuation, multiply, divide
+		return CharE::SPLIT;
+	if( cp < 0x2000 )
+		return CharE::WORD;
+	if( cp < 0x2C00 )  // general punctuation, symbol, arrow, math, box drawing, dingbat
+		return CharE::SPLIT;
+	if( cp >= 0x2E00 && cp < 0x2E80 )  // supplemental punctuation
+		return CharE::SPLIT;
+	if( cp >= 0x3000 && cp < 0x3040 )  // CJK space and punctuation
+		return CharE::SPLIT;
+	if( ( cp >= 0x2E80 && cp < 0x3100 ) || ( cp >= 0x31F0 && cp < 0x3200 ) || ( cp >= 0x3400 && cp < 0xA000 )
+			|| ( cp >= 0xF900 && cp < 0xFB00 ) || ( cp >= 0x20000 && cp < 0x32000 ) )  // radical, kana, ideograph
+		return CharE::SINGLE;
+	if( cp >= 0xFE10 && cp < 0xFE70 )  // vertical, compatibility and small form punctuation
+		return CharE::SPLIT;
+	if( cp >= 0xFF00 && cp < 0xFF66 ) {  // fullwidth ascii, only letter and digit is word
+		uint32_t a = cp - 0xFF00 + 0x20;
+		return classify( a ) == CharE::WORD ? CharE::WORD : CharE::SPLIT;
+	}
+	if( cp == 0xFEFF || cp == 0xFFFD )
+		return CharE::SPLIT;
+	return CharE::WORD;
+}
+
+inline size_t IndexTokenizer::encode( uint32_t cp, char * out )
+{
+	if( cp < 0x80 ) {
+		out[0] = (char)cp;
+		return 1;
+	}
+	if( cp < 0x800 ) {
+		out[0] = (char)( 0xC0 | ( cp >> 6 ) );
+		out[1] = (char)( 0x80 | ( cp & 0x3F ) );
+		return 2;
+	}
+	if( cp < 0x10000 ) {
+		out[0] = (char)( 0xE0 | ( cp >> 12 ) );
+		out[1] = (char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+		out[2] = (char)( 0x80 | ( cp & 0x3F ) );
+		return 3;
+	}
+	out[0] = (char)( 0xF0 | ( cp >> 18 ) );
+	out[1] = (char)( 0x80 | ( ( cp >> 12 ) & 0x3F ) );
+	out[2] = (char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+	out[3] = (char)( 0x80 | ( cp & 0x3F ) );
+	return 4;
+}
+
+template< class F >
+void IndexTokenizer::ForEach( std::string_view text, F func )
+{
+	char buf[MAX_TOKEN_LEN];
+	size_t len = 0;
+	bool full = false;  // rest of long token is dropped
+	const uint8_t * p = (const uint8_t *)text.data();
+	size_t size = text.size();
+	for( size_t i = 0; i < size; ) {
+		size_t n = 1;
+		uint32_t cp = ( p[i] < 0x80 ) ? p[i] : decode( p + i, size - i, n );
+		i += n;
+		CharE type = classify( cp );
+		if( type == CharE::WORD ) {
+			char ch[4];
+			size_t clen = encode( fold( cp ), ch );
+			if( full || len + clen > MAX_TOKEN_LEN ) {
+				full = true;
+				continue;
+			}
+			for( size_t k = 0; k < clen; ++k )
+				buf[len++] = ch[k];
+			continue;
+		}
+		if( len > 0 )
+			func( std::string_view( buf, len ) );
+		len = 0;
+		full = false;
+		if( type == CharE::SINGLE ) {
+			char ch[4];
+			func( std::string_view( ch, encode( cp, ch ) ) );
+		}
+	}
+	if( len > 0 )
+		func( std::string_view( buf, len ) );
+	return;
+}
+
+////////////////////////////////
+END_NS_SPD
+
+#endif // INCLUDED_SPD_INDEX_H
@@ -0,0 +1,186 @@
+// SPD_Replace.cpp : spdocx multi pattern text replace
+// Copyright (C) 2021 ~ 2025 drangon <drangon_zhou (at) hotmail.com>
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+#include "SPD_Replace.h"
+
+#include <algorithm>
+
+BEGIN_NS_SPD
+////////////////////////////////
+
+int TextReplacer::Add( std::string_view pattern, std::string_view replace )
+{
+	if( pattern.empty() )
+		return SPD_ERR_BAD_PARAM;
+	auto it = m_index.find( pattern );
+	if( it != m_index.end() ) {
+		m_replace[it->second].assign( replace.data(), replace.size() );
+		return SPD_ERR_OK;
+	}
+	m_index.emplace( std::string( pattern ), (int)m_pattern.size() );
+	m_pattern.emplace_back( pattern );
+	m_replace.emplace_back( replace );
+	m_built = false;
+	return SPD_ERR_OK;
+}
+
+void TextReplacer::Clear()
+{
+	m_pattern.clear();
+	m_replace.clear();
+	m_index.clear();
+	m_state.assign( 1, State() );
+	m_edge.clear();
+	for( int i = 0; i < 256; ++i )
+		m_root[i] = 0;
+	m_built = false;
+	return;
+}
+
+int TextReplacer::Build()
+{
+	// trie with child map first, then flatten edge in bfs order
+	std::vector< std::map<uint8_t, int> > child( 1 );
+	std::vector<int> out( 1, -1 );
+	for( size_t i = 0; i < m_pattern.size(); ++i ) {
+		int st = 0;
+		for( char ch : m_pattern[i] ) {
+			uint8_t c = (uint8_t)ch;
+			auto it = child[st].find( c );
+			if( it == child[st].end() ) {
+				child[st][c] = (int)child.size();
+				st = (int)child.size();
+				child.emplace_back();
+				out.push_back( -1 );
+			}
+			else
+				st = it->second;
+		}
+		out[st] = (int)i;
+	}
+
+	m_state.assign( child.size(), State() );
+	m_edge.clear();
+	m_edge.reserve( child.size() - 1 );
+	for( int i = 0; i < 256; ++i )
+		m_root[i] = 0;
+	std::vector<int> queue;
+	queue.reserve( child.size() );
+	queue.push_back( 0 );
+	for( size_t q = 0; q < queue.size(); ++q ) {
+		int u = queue[q];
+		State & su = m_state[u];
+		su.m_out = out[u];
+		su.m_edgeBegin = (uint32_t)m_edge.size();
+		for( auto & kv : child[u] ) {
+			int v = kv.second;
+			m_edge.push_back( Edge{ kv.first, v } );
+			queue.push_back( v );
+			if( u == 0 ) {
+				m_root[kv.first] = v;
+				continue;
+			}
+			// fail of child is goto( fail chain of parent, c ), parent's chain is done in bfs order
+			int f = su.m_fail;
+			int to = 0;
+			for( ;; ) {
+				auto it = child[f].find( kv.first );
+				if( it != child[f].end() ) {
+					to = it->second;
+					break;
+				}
+				if( f == 0 )
+					break;
+				f = m_state[f].m_fail;
+			}
+			m_state[v].m_fail = to;
+			m_state[v].m_dict = ( out[to] >= 0 ) ? to : m_state[to].m_dict;
+		}
+		su.m_edgeEnd = (uint32_t)m_edge.size();
+	}
+	m_built = true;
+	return (int)m_pattern.size();
+}
+
+int TextReplacer::find_edge( int st, uint8_t c ) const
+{
+	const State & s = m_state[st];
+	auto first = m_edge.begin() + s.m_edgeBegin;
+	auto last = m_edge.begin() + s.m_edgeEnd;
+	auto it = std::lower_bound( first, last, c, []( const Edge & e, uint8_t ch ) { return e.m_char < ch; } );
+	return ( it != last && it->m_char == c ) ? it->m_next : -1;
+}
+
+int TextReplacer::next_state( int st, uint8_t c ) const
+{
+	while( st != 0 ) {
+		int to = find_edge( st, c );
+		if( to >= 0 )
+			return to;
+		st = m_state[st].m_fail;
+	}
+	return m_root[c];
+}
+
+int TextReplacer::FindAll( std::string_view text, std::vector<Match> & matches ) const
+{
+	matches.clear();
+	if( !m_built || m_pattern.empty() )
+		return 0;
+	int st = 0;
+	for( size_t i = 0; i < text.size(); ++i ) {
+		st = next_state( st, (uint8_t)text[i] );
+		int s = ( m_state[st].m_out >= 0 ) ? st : m_state[st].m_dict;
+		for( ; s != 0; s = m_state[s].m_dict ) {
+			int idx = m_state[s].m_out;
+			size_t len = m_pattern[idx].size();
+			matches.push_back( Match{ i + 1 - len, len, idx } );
+		}
+	}
+	if( matches.empty() )
+		return 0;
+
+	// leftmost first, longest at same position, drop overlapped
+	std::sort( matches.begin(), matches.end(), []( const Match & a, const Match & b ) {
+		return a.m_pos != b.m_pos ? a.m_pos < b.m_pos : a.m_len > b.m_len;
+	} );
+	size_t num = 0, end = 0;
+	for( const Match & m : matches ) {
+		if( m.m_pos < end )
+			continue;
+		matches[num++] = m;
+		end = m.m_pos + m.m_len;
+	}
+	matches.resize( num );
+	return (int)num;
+}
+
+int TextReplacer::ReplaceAll( std::string_view text, std::string & out ) const
+{
+	std::vector<Match> matches;
+	int num = FindAll( text, matches );
+	size_t pos = 0;
+	for( const Match & m : matches ) {
+		out.append( text.data() + pos, m.m_pos - pos );
+		out.append( m_replace[m.m_idx] );
+		pos = m.m_pos + m.m_len;
+	}
+	out.append( text.data() + pos, text.size() - pos );
+	return num;
+}
+
+////////////////////////////////
+END_NS_SPD
@@ -0,0 +1,94 @@
+// SPD_Replace.h : spdocx multi pattern text replace
+// Copyright (C) 2021 ~ 2025 drangon <drangon_zhou (at) hotmail.com>
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+#ifndef INCLUDED_SPD_REPLACE_H
+#define INCLUDED_SPD_REPLACE_H
+
+#include "SPD_Common.h"
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+BEGIN_NS_SPD
+////////////////////////////////
+
+// dictionary of pattern -> replacement, all pattern is matched in one pass ( Aho-Corasick ), ex :
+//   TextReplacer rep;
+//   rep.Add( "{{name}}", "Alice" ); rep.Add( "{{date}}", "2025-01-01" ); rep.Build();
+//   doc.Replace( rep );
+// build once and reuse for every paragraph, const method is thread safe
+class SPD_API TextReplacer
+{
+public:
+	class Match
+	{
+	public:
+		size_t m_pos;  // byte offset in text
+		size_t m_len;  // pattern length
+		int m_idx;     // pattern index
+	};
+
+	TextReplacer() { Clear(); }
+
+	int Add( std::string_view pattern, std::string_view replace );  // same pattern overwrite replace, empty pattern is SPD_ERR_BAD_PARAM
+	int Build();  // build automaton after all Add(), return pattern num
+	void Clear();
+
+	int GetPatternNum() const { return (int)m_pattern.size(); }
+	const std::string & GetPattern( int idx ) const { return m_pattern[idx]; }
+	const std::string & GetReplace( int idx ) const { return m_replace[idx]; }
+
+	// non-overlapping match from left, longest pattern win at same position, return match num
+	int FindAll( std::string_view text, std::vector<Match> & matches ) const;
+	// replace all match of text into out, return match num
+	int ReplaceAll( std::string_view text, std::string & out ) const;
+
+private:
+	class State
+	{
+	public:
+		uint32_t m_edgeBegin = 0;  // [begin, end) in m_edge, sorted by char
+		uint32_t m_edgeEnd = 0;
+		int m_fail = 0;
+		int m_out = -1;   // pattern end at this state
+		int m_dict = 0;   // nearest fail state with m_out, 0 means none
+	};
+	class Edge
+	{
+	public:
+		uint8_t m_char;
+		int m_next;
+	};
+
+	int next_state( int st, uint8_t c ) const;
+	int find_edge( int st, uint8_t c ) const;
+
+	std::vector<std::string> m_pattern;
+	std::vector<std::string> m_replace;
+	std::map< std::string, int, std::less<> > m_index;  // pattern -> index
+	std::vector<State> m_state;  // state 0 is root
+	std::vector<Edge> m_edge;
+	int m_root[256];  // goto of root, no fail walk for most char
+	bool m_built = false;
+};
+
+////////////////////////////////
+END_NS_SPD
+
+#endif // INCLUDED_SPD_REPLACE_H
@@ -0,0 +1,179 @@
+// SPD_Visitor.h : spdocx element visitor
+// Copyright (C) 2021 ~ 2025 drangon <drangon_zhou (at) hotmail.com>
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+#ifndef INCLUDED_SPD_VISITOR_H
+#define INCLUDED_SPD_VISITOR_H
+
+#include "SPD_Common.h"
+#include "SPD_Element.h"
+#include "SPD_Document.h"
+
+#include <vector>
+
+BEGIN_NS_SPD
+////////////////////////////////
+
+enum class VisitResultE : uint8_t
+{
+	CONTINUE,       // visit child
+	SKIP_CHILDREN,  // not visit child, continue with next sibling
+	STOP,           // stop visit
+};
+
+// position of current Element, maintained by walker, no need to resolve parent again
+class VisitContext
+{
+public:
+	int m_depth = 0;           // 0 is the first visited level
+	int m_index = 0;           // index in visited sibling
+	Element m_parent;          // INVALID for the first visited level
+	Table m_table{ Element() };  // nearest table, INVALID if not in table
+	int m_row = -1;            // row index in nearest table, -1 if not in row
+	int m_col = -1;            // grid col of cell in nearest table ( span counted ), -1 if not in cell
+	int m_colNum = -1;         // column num of nearest table, read once when enter table
+};
+
+// non-recursive visitor, Derived hide the callback it need, ex :
+//   class MyVisitor : public Visitor<MyVisitor> {
+//   public:
+//     VisitResultE OnParagraph( const Paragraph & par, const VisitContext & ctx ) { ...; return VisitResultE::CONTINUE; }
+//   };
+//   MyVisitor v; v.Visit( doc );
+// OnEnter() is called before the type callback, if not CONTINUE, the type callback is not called
+// OnLeave() is called after all child is visited ( or skipped ), not called when STOP
+template< class Derived >
+class Visitor
+{
+public:
+	VisitResultE OnEnter( const Element & ele, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+	void OnLeave( const Element & ele, const VisitContext & ctx ) { }
+
+	VisitResultE OnParagraph( const Paragraph & par, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+	VisitResultE OnHyperlink( const Hyperlink & hlk, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+	VisitResultE OnRun( const Run & run, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+	VisitResultE OnTable( const Table & tbl, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+	VisitResultE OnTRow( const TRow & row, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+	VisitResultE OnTCell( const TCell & cell, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+	VisitResultE OnOther( const Element & ele, const VisitContext & ctx ) { return VisitResultE::CONTINUE; }
+
+	// visit all top level Element of doc
+	bool Visit( const Document & doc ) { return Visit( doc.GetFirstElement() ); }
+	// visit first and all its following sibling, return false if STOP
+	bool Visit( const Element & first );
+
+private:
+	struct Frame
+	{
+		Element m_ele;      // current Element in this level
+		VisitContext m_ctx;
+	};
+
+	VisitResultE call_type( const Element & ele, const VisitContext & ctx );
+	static void next_sibling( Frame & f );
+
+	std::vector<Frame> m_stack;  // explicit stack, keep capacity for next Visit()
+};
+
+template< class Derived >
+VisitResultE Visitor<Derived>::call_type( const Element & ele, const VisitContext & ctx )
+{
+	Derived * d = static_cast<Derived *>( this );
+	switch( ele.GetType() )
+	{
+	case ElementTypeE::PARAGRAPH:
+		return d->OnParagraph( Paragraph( ele ), ctx );
+	case ElementTypeE::HYPERLINK:
+		return d->OnHyperlink( Hyperlink( ele ), ctx );
+	case ElementTypeE::RUN:
+		return d->OnRun( Run( ele ), ctx );
+	case ElementTypeE::TABLE:
+		return d->OnTable( Table( ele ), ctx );
+	case ElementTypeE::TABLE_ROW:
+		return d->OnTRow( TRow( ele ), ctx );
+	case ElementTypeE::TABLE_CELL:
+		return d->OnTCell( TCell( ele ), ctx );
+	default:
+		return d->OnOther( ele, ctx );
+	}
+}
+
+template< class Derived >
+void Visitor<Derived>::next_sibling( Frame & f )
+{
+	f.m_ctx.m_index += 1;
+	if( f.m_ele.GetType() == ElementTypeE::TABLE_ROW )
+		f.m_ctx.m_row += 1;
+	else if( f.m_ele.GetType() == ElementTypeE::TABLE_CELL )
+		f.m_ctx.m_col += TCell( f.m_ele ).GetSpanNum();
+	f.m_ele = f.m_ele.GetNext();
+	return;
+}
+
+template< class Derived >
+bool Visitor<Derived>::Visit( const Element & first )
+{
+	Derived * d = static_cast<Derived *>( this );
+	m_stack.clear();
+	m_stack.push_back( Frame{ first, VisitContext() } );
+
+	while( !m_stack.empty() ) {
+		Element ele = m_stack.back().m_ele;
+		if( !ele.IsValid() ) {
+			// level finished, leave parent and move parent to its next sibling
+			m_stack.pop_back();
+			if( m_stack.empty() )
+				break;
+			d->OnLeave( m_stack.back().m_ele, m_stack.back().m_ctx );
+			next_sibling( m_stack.back() );
+			continue;
+		}
+
+		const VisitContext & ctx = m_stack.back().m_ctx;
+		VisitResultE ret = d->OnEnter( ele, ctx );
+		if( ret == VisitResultE::CONTINUE )
+			ret = call_type( ele, ctx );
+		if( ret == VisitResultE::STOP )
+			return false;
+		if( ret == VisitResultE::CONTINUE ) {
+			Element child = ele.GetFirstChild();
+			if( child.IsValid() ) {
+				VisitContext cctx = ctx;
+				cctx.m_depth = ctx.m_depth + 1;
+				cctx.m_index = 0;
+				cctx.m_parent = ele;
+				if( ele.GetType() == ElementTypeE::TABLE ) {
+					cctx.m_table = Table( ele );
+					cctx.m_row = 0;
+					cctx.m_col = -1;
+					cctx.m_colNum = cctx.m_table.GetColNum();
+				}
+				else if( ele.GetType() == ElementTypeE::TABLE_ROW ) {
+					cctx.m_col = 0;
+				}
+				m_stack.push_back( Frame{ child, cctx } );
+				continue;  // leave when child level finished
+			}
+		}
+		d->OnLeave( ele, ctx );
+		next_sibling( m_stack.back() );
+	}
+	return true;
+}
+
+////////////////////////////////
+END_NS_SPD
+
+#endif // INCLUDED_SPD_VISITOR_H
@@ -15,11 +15,19 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "SPD_Document.h"
+#include "SPD_Visitor.h"
+#include "SPD_Replace.h"
+#include "SPD_Index.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <set>
+#include <sstream>
 #include <string>
+#include <chrono>
 
+#include <string.h>
 #include <time.h>
 
 BEGIN_NS_SPD
@@ -29,8 +37,126 @@ class SPDDebug
 {
 public:
 	static void DumpDocument( Document * doc );
+	static int BenchNavClassify( const Document & doc );
+	static void CorruptTable( Table & tbl );
+	static void DropVMergeVal( Table & tbl );
+	static std::string DocumentXml( const Document & doc );
+	static std::string ElementXml( const Element & ele );
+	static bool HasBodyRange( const Document & doc );
+	static int BreakBodyRange( Document & doc );
+	static void SetRunStyle( Run & run, const char * id );
+	static bool ElemIndexValid( const Document & doc ) { return doc.m_elemIndexValid; }
+	static int MaxElemIndexEdit() { return Document::MAX_ELEM_INDEX_EDIT; }
+	static int QueryCacheSize( const Document & doc ) { return (int)doc.m_query.size(); }
+	static void SetParaId( Element & ele, const char * id );
+	static int CheckIdIndex( const Document & doc );
 };
 
+// break table like third-party tool, through xml directly
+void SPDDebug::CorruptTable( Table & tbl )
+{
+	pugi::xml_node r0 = tbl.m_nd.child( "w:tr" );
+	pugi::xml_node r1 = r0.next_sibling( "w:tr" );
+	pugi::xml_node r2 = r1.next_sibling( "w:tr" );
+	// bad span, orphan vmerge with unknown value, short row, empty cell, extra grid col
+	Element::GetCreateAttr( Element::GetCreateChild( Element::GetCreateChild( r0.child( "w:tc" ), "w:tcPr" ), "w:gridSpan" ), "w:val" ).set_value( "0" );
+	Element::GetCreateAttr( Element::GetCreateChild( Element::GetCreateChild( r1.child( "w:tc" ).next_sibling( "w:tc" ), "w:tcPr" ), "w:vMerge" ), "w:val" ).set_value( "merge" );
+	r2.remove_child( r2.last_child() );
+	r2.child( "w:tc" ).remove_child( "w:p" );
+	tbl.m_nd.child( "w:tblGrid" ).append_child( "w:gridCol" ).append_attribute( "w:w" ) = 1000;
+}
+
+// continue cell as written by Word, <w:vMerge/> without w:val
+void SPDDebug::DropVMergeVal( Table & tbl )
+{
+	for( pugi::xml_node rnd = tbl.m_nd.child( "w:tr" ); !rnd.empty(); rnd = rnd.next_sibling( "w:tr" ) ) {
+		for( pugi::xml_node cnd = rnd.child( "w:tc" ); !cnd.empty(); cnd = cnd.next_sibling( "w:tc" ) ) {
+			pugi::xml_node vnd = cnd.child( "w:tcPr" ).child( "w:vMerge" );
+			if( strcmp( vnd.attribute( "w:val" ).value(), "continue" ) == 0 )
+				vnd.remove_attribute( "w:val" );
+		}
+	}
+}
+
+std::string SPDDebug::DocumentXml( const Document & doc )
+{
+	std::ostringstream os;
+	doc.m_doc.save( os, "", pugi::format_raw );
+	return os.str();
+}
+
+std::string SPDDebug::ElementXml( const Element & ele )
+{
+	std::ostringstream os;
+	ele.m_nd.print( os, "", pugi::format_raw );
+	return os.str();
+}
+
+bool SPDDebug::HasBodyRange( const Document & doc )
+{
+	return doc.m_bodyHead != 0 && !doc.m_bodyRange.empty();
+}
+
+// source bytes of second body child not match parsed offset, like a rewritten buffer
+int SPDDebug::BreakBodyRange( Document & doc )
+{
+	std::vector<char> & fbuf = doc.m_files["word/document.xml"];
+	pugi::xml_node nd = doc.m_doc.document_element().first_child().first_child().next_sibling();
+	ptrdiff_t off = nd.offset_debug();
+	if( off > 0 && (size_t)off < fbuf.size() )
+		fbuf[off - 1] = ' ';
+	return doc.load_body_range();
+}
+
+// no api of character style, w:rStyle is first of w:rPr
+void SPDDebug::SetRunStyle( Run & run, const char * id )
+{
+	pugi::xml_node rpr = run.m_nd.child( "w:rPr" );
+	if( rpr.empty() )
+		rpr = run.m_nd.prepend_child( "w:rPr" );
+	rpr.prepend_child( "w:rStyle" ).append_attribute( "w:val" ).set_value( id );
+}
+
+void SPDDebug::SetParaId( Element & ele, const char * id )
+{
+	Element::GetCreateAttr( ele.m_nd, "w14:paraId" ).set_value( id );
+}
+
+// id map is one to one on live node only, and every w14:paraId of a rebuilt index is kept
+int SPDDebug::CheckIdIndex( const Document & doc )
+{
+	std::set<const pugi::xml_node_struct *> live;
+	std::vector<pugi::xml_node> stack( 1, doc.m_doc.document_element() );
+	while( !stack.empty() ) {
+		pugi::xml_node nd = stack.back();
+		stack.pop_back();
+		live.insert( nd.internal_object() );
+		for( pugi::xml_node cnd = nd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() )
+			stack.push_back( cnd );
+	}
+	int err = 0;
+	if( doc.m_idNode.size() != doc.m_nodeId.size() )
+		++err;
+	for( const auto & kv : doc.m_nodeId ) {
+		auto it = doc.m_idNode.find( kv.second );
+		if( live.count( kv.first ) == 0 || it == doc.m_idNode.end() || it->second != kv.first )
+			++err;
+	}
+	// node of duplicate paraId may already have a memory id, which is kept
+	Document & mdoc = const_cast<Document &>( doc );
+	auto idNode = doc.m_idNode;
+	auto nodeId = doc.m_nodeId;
+	mdoc.build_id_index();
+	for( const auto & kv : doc.m_idNode ) {
+		auto it = idNode.find( kv.first );
+		if( ( it == idNode.end() || it->second != kv.second ) && nodeId.count( kv.second ) == 0 )
+			++err;
+	}
+	mdoc.m_idNode.swap( idNode );
+	mdoc.m_nodeId.swap( nodeId );
+	return err;
+}
+
 void SPDDebug::DumpDocument( Document * doc )
 {
 	printf( "[doc] %p\n", doc );
@@ -45,104 +171,179 @@ void SPDDebug::DumpDocument( Document * doc )
 	return;
 }
 
+// strcmp chain before tag id, only for benchmark compare
+static ElementTypeE legacy_node_type( pugi::xml_node nd )
+{
+	if( !nd )
+		return ElementTypeE::INVALID;
+	if( strcmp( nd.name(), "w:p" ) == 0 )
+		return ElementTypeE::PARAGRAPH;
+	if( strcmp( nd.name(), "w:r" ) == 0 ) {
+		if( !nd.child( "w:t" ).empty() || !nd.child( "w:drawing" ).empty() || !nd.child( "w:object" ).empty() )
+			return ElementTypeE::RUN;
+		return ElementTypeE::UNKNOWN;
+	}
+	if( strcmp( nd.name(), "w:hyperlink" ) == 0 )
+		return ElementTypeE::HYPERLINK;
+	if( strcmp( nd.name(), "w:tbl" ) == 0 )
+		return ElementTypeE::TABLE;
+	if( strcmp( nd.name(), "w:tr" ) == 0 )
+		return ElementTypeE::TABLE_ROW;
+	if( strcmp( nd.name(), "w:tc" ) == 0 )
+		return ElementTypeE::TABLE_CELL;
+	return ElementTypeE::UNKNOWN;
+}
+
+static bool legacy_skipped_node( pugi::xml_node nd )
+{
+	return nd.type() != pugi::node_element
+		|| strcmp( nd.name(), "w:t" ) == 0 || strcmp( nd.name(), "w:pPr" ) == 0
+		|| strcmp( nd.name(), "w:rPr" ) == 0 || strcmp( nd.name(), "w:tblPr" ) == 0
+		|| strcmp( nd.name(), "w:tblGrid" ) == 0 || strcmp( nd.name(), "w:trPr" ) == 0
+		|| strcmp( nd.name(), "w:tcPr" ) == 0 || strcmp( nd.name(), "w:sectPr" ) == 0;
+}
+
+static void collect_node( pugi::xml_node nd, std::vector<pugi::xml_node> & nodes )
+{
+	for( pugi::xml_node cnd = nd.first_child(); !cnd.empty(); cnd = cnd.next_sibling() ) {
+		if( cnd.type() != pugi::node_element )
+			continue;
+		nodes.push_back( cnd );
+		collect_node( cnd, nodes );
+	}
+}
+
+int SPDDebug::BenchNavClassify( const Document & doc )
+{
+	std::vector<pugi::xml_node> nodes;
+	collect_node( doc.m_doc.document_element(), nodes );
+	if( nodes.empty() )
+		return -1;
+
+	const int loop = 20;
+	int sum1 = 0, sum2 = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	for( int i = 0; i < loop; ++i ) {
+		for( auto & nd : nodes )
+			sum1 += (int)legacy_node_type( nd ) + ( legacy_skipped_node( nd ) ? 1 : 0 );
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	for( int i = 0; i < loop; ++i ) {
+		for( auto & nd : nodes ) {
+			TagIdE tag = Element::GetTagId( nd );
+			bool skip = tag == TagIdE::W_T || tag == TagIdE::W_PPR || tag == TagIdE::W_RPR || tag == TagIdE::W_TBLPR
+				|| tag == TagIdE::W_TBLGRID || tag == TagIdE::W_TRPR || tag == TagIdE::W_TCPR || tag == TagIdE::W_SECTPR;
+			sum2 += (int)Element::GetNodeType( nd ) + ( skip ? 1 : 0 );
+		}
+	}
+	auto t2 = std::chrono::steady_clock::now();
+
+	double n = (double)nodes.size() * loop;
+	double ns1 = std::chrono::duration<double, std::nano>( t1 - t0 ).count() / n;
+	double ns2 = std::chrono::duration<double, std::nano>( t2 - t1 ).count() / n;
+	printf( "b_nav: classify %d nodes x %d, strcmp %.1f ns/node, tag id %.1f ns/node, speedup %.2fx%s\n",
+		(int)nodes.size(), loop, ns1, ns2, ns2 > 0 ? ns1 / ns2 : 0.0, sum1 == sum2 ? "" : " (MISMATCH)" );
+	return sum1 == sum2 ? 0 : -1;
+}
+
 ////////////////////////////////
 END_NS_SPD
 
 using namespace spd;
 
-static void dump_element( const Document & doc, Element ele, int level )
+class DumpVisitor : public Visitor<DumpVisitor>
+{
+public:
+	DumpVisitor( const Document & doc ) : m_doc( doc ) { }
+
+	VisitResultE OnEnter( const Element & ele, const VisitContext & ctx );
+
+private:
+	const Document & m_doc;
+};
+
+VisitResultE DumpVisitor::OnEnter( const Element & ele, const VisitContext & ctx )
 {
 	static const char pre[16] = "               ";
-	const char * p = ( level >= 15 ) ? pre : pre + 15 - level;
-	int cell = 0;
-	int col = 0;
-	int row = 0;
-	for( ; ele.GetType() != ElementTypeE::INVALID; ele = ele.GetNext() ) {
-		printf( "%s[%s] (%d)\n", p, ele.GetTag(), (int)ele.GetType() );
-		switch( ele.GetType() )
-		{
-		case ElementTypeE::PARAGRAPH :
-		{
-			Paragraph par = ele;
-			printf( "<style> [%s]\n", par.GetStyleName( doc ) );
-			printf( "<text> [%s]\n", par.GetText().c_str() );
-		}
-			break;
-		case ElementTypeE::HYPERLINK :
-		{
-			Hyperlink hlk = ele;
-			printf( "<Anchor> [%s]\n", hlk.GetAnchor() ? hlk.GetAnchor() : "<nullptr>" );
-			printf( "<RelaId> [%s]\n", hlk.GetRelaId() ? hlk.GetRelaId() : "<nullptr>" );
-			if( hlk.GetRelaId() != nullptr ) {
-				printf( "<RelaType> [%s]\n", hlk.GetRelaType( doc ).c_str() );
-				printf( "<TargetMode> [%s]\n", hlk.GetRelaTargetMode( doc ).c_str() );
-				printf( "<Target> [%s]\n", hlk.GetRelaTarget( doc ).c_str() );
-			}
-			printf( "<text> [%s]\n", hlk.GetText().c_str() );
+	const char * p = ( ctx.m_depth >= 15 ) ? pre : pre + 15 - ctx.m_depth;
+	const Document & doc = m_doc;
+	printf( "%s[%s] (%d)\n", p, ele.GetTag(), (int)ele.GetType() );
+	switch( ele.GetType() )
+	{
+	case ElementTypeE::PARAGRAPH :
+	{
+		Paragraph par = ele;
+		printf( "<style> [%s]\n", par.GetStyleName( doc ) );
+		printf( "<text> [%s]\n", par.GetText().c_str() );
+	}
+		break;
+	case ElementTypeE::HYPERLINK :
+	{
+		Hyperlink hlk = ele;
+		printf( "<Anchor> [%s]\n", hlk.GetAnchor() ? hlk.GetAnchor() : "<nullptr>" );
+		printf( "<RelaId> [%s]\n", hlk.GetRelaId() ? hlk.GetRelaId() : "<nullptr>" );
+		if( hlk.GetRelaId() != nullptr ) {
+			printf( "<RelaType> [%s]\n", hlk.GetRelaType( doc ).c_str() );
+			printf( "<TargetMode> [%s]\n", hlk.GetRelaTargetMode( doc ).c_str() );
+			printf( "<Target> [%s]\n", hlk.GetRelaTarget( doc ).c_str() );
 		}
-			break;
-		case ElementTypeE::RUN :
-		{
-			Run run = ele;
-			if( run.IsText() ) {
-				printf( "<color> [%s], <hightline> [%s]\n", run.GetColor(), run.GetHighline() );
-				printf( "<bold> [%s], <italic> [%s], <underline> [%s], <strike> [%s], <dstrike> [%s]\n",
-					run.GetBold() ? "true" : "false",
-					run.GetItalic() ? "true" : "false",
-					run.GetUnderline(),
-					run.GetStrike() ? "true" : "false",
-					run.GetDoubleStrike() ? "true" : "false" );
-				printf( "<text> [%s]\n", run.GetText().c_str() );
-			}
-			else if( run.IsPic() ) {
-				printf( "<PicId> [%s]\n", run.GetPicRelaId() ? run.GetPicRelaId() : "<nullptr>" );
-			}
-			else if( run.IsObject() ) {
-				printf( "<ObjectId> [%s]\n", run.GetObjectRelaId() ? run.GetObjectRelaId() : "<nullptr>" );
-				printf( "<ProgId> [%s]\n", run.GetObjectProgId() ? run.GetObjectProgId() : "<nullptr>" );
-				printf( "<ImgId> [%s]\n", run.GetObjectImgRelaId() ? run.GetObjectImgRelaId() : "<nullptr>" );
-			}
+		printf( "<text> [%s]\n", hlk.GetText().c_str() );
+	}
+		break;
+	case ElementTypeE::RUN :
+	{
+		Run run = ele;
+		if( run.IsText() ) {
+			printf( "<color> [%s], <hightline> [%s]\n", run.GetColor(), run.GetHighline() );
+			printf( "<bold> [%s], <italic> [%s], <underline> [%s], <strike> [%s], <dstrike> [%s]\n",
+				run.GetBold() ? "true" : "false",
+				run.GetItalic() ? "true" : "false",
+				run.GetUnderline(),
+				run.GetStrike() ? "true" : "false",
+				run.GetDoubleStrike() ? "true" : "false" );
+			printf( "<text> [%s]\n", run.GetText().c_str() );
 		}
-			break;
-		case ElementTypeE::TABLE :
-		{
-			Table tbl = ele;
-			row = 0;
-			printf( "<table> Row %d, Col %d, width [", tbl.GetRowNum(), tbl.GetColNum() );
-			for( int i = 0; i < tbl.GetColNum(); ++i ) {
-				if( i != 0 )
-					printf( "," );
-				printf( " %d", tbl.GetColWidth( i ) );
-			}
-			printf( " ]\n" );
+		else if( run.IsPic() ) {
+			printf( "<PicId> [%s]\n", run.GetPicRelaId() ? run.GetPicRelaId() : "<nullptr>" );
 		}
-			break;
-		case ElementTypeE::TABLE_ROW :
-			printf( "<table row %d>\n", row++ );
-			cell = 0;
-			col = 0;
-			break;
-		case ElementTypeE::TABLE_CELL :
-		{
-			TCell tc = ele;
-			printf( "<table cell %d (col %d)> span %d, vmerge %d\n", cell, col, tc.GetSpanNum(), (int)tc.GetVMergeType() );
-			++cell;
-			col += tc.GetSpanNum();
-			printf( "<text> [%s]", tc.GetText().c_str() );
+		else if( run.IsObject() ) {
+			printf( "<ObjectId> [%s]\n", run.GetObjectRelaId() ? run.GetObjectRelaId() : "<nullptr>" );
+			printf( "<ProgId> [%s]\n", run.GetObjectProgId() ? run.GetObjectProgId() : "<nullptr>" );
+			printf( "<ImgId> [%s]\n", run.GetObjectImgRelaId() ? run.GetObjectImgRelaId() : "<nullptr>" );
 		}
-			break;
-		case ElementTypeE::BOOKMARK_END :
-			printf( "<bookmark end>\n" );
-			break;
-		default:
-			break;
+	}
+		break;
+	case ElementTypeE::TABLE :
+	{
+		Table tbl = ele;
+		printf( "<table> Row %d, Col %d, width [", tbl.GetRowNum(), tbl.GetColNum() );
+		for( int i = 0; i < tbl.GetColNum(); ++i ) {
+			if( i != 0 )
+				printf( "," );
+			printf( " %d", tbl.GetColWidth( i ) );
 		}
-		dump_element( doc, ele.GetFirstChild(), level + 1 );
+		printf( " ]\n" );
 	}
-	return;
+		break;
+	case ElementTypeE::TABLE_ROW :
+		printf( "<table row %d>\n", ctx.m_row );
+		break;
+	case ElementTypeE::TABLE_CELL :
+	{
+		TCell tc = ele;
+		printf( "<table cell %d (col %d)> span %d, vmerge %d\n", ctx.m_index, ctx.m_col, tc.GetSpanNum(), (int)tc.GetVMergeType() );
+		printf( "<text> [%s]", tc.GetText().c_str() );
+	}
+		break;
+	case ElementTypeE::BOOKMARK_END :
+		printf( "<bookmark end>\n" );
+		break;
+	default:
+		break;
+	}
+	return VisitResultE::CONTINUE;
 }
 
-
 static int dumpinfo( const char * fname )
 {
 	int ret;
@@ -160,7 +361,8 @@ static int dumpinfo( const char * fname )
 	Element ele2 = ele.GetParent();
 	printf( "parent is %d\n", (int)ele2.GetType() );
 
-	dump_element( doc, ele, 0 );
+	DumpVisitor visitor( doc );
+	visitor.Visit( ele );
 
 	ele = Element(); // nullptr
 	doc.Close();
@@ -206,6 +408,153 @@ static int dumpdirjson( const char * fname )
 	return 0;
 }
 
+static int dumptables( int argc, char * argv[] )
+{
+	bool verbose = false;
+	std::vector<TableColumns> tables;  // reused for every file
+	int files = 0, tablenum = 0;
+	size_t cells = 0, bytes = 0;
+	double ms_open = 0, ms_extract = 0;
+	for( int i = 0; i < argc; ++i ) {
+		if( strcmp( argv[i], "-v" ) == 0 ) {
+			verbose = true;
+			continue;
+		}
+		Document doc;
+		auto t0 = std::chrono::steady_clock::now();
+		int ret = doc.Open( argv[i] );
+		auto t1 = std::chrono::steady_clock::now();
+		if( ret < 0 ) {
+			printf( "[%s] open failed, ret %d\n", argv[i], ret );
+			continue;
+		}
+		int num = doc.ExtractTables( tables );
+		auto t2 = std::chrono::steady_clock::now();
+		ms_open += std::chrono::duration<double, std::milli>( t1 - t0 ).count();
+		ms_extract += std::chrono::duration<double, std::milli>( t2 - t1 ).count();
+		++files;
+		tablenum += num;
+
+		printf( "[%s] %d tables\n", argv[i], num );
+		for( int t = 0; t < num; ++t ) {
+			const TableColumns & tc = tables[t];
+			size_t tbytes = 0;
+			for( int c = 0; c < tc.m_colNum; ++c )
+				tbytes += tc.m_cols[c].m_data.size();
+			printf( "  table %d parent %d : %d x %d, %d merges, %d bytes\n", t, tc.m_parent, tc.m_rowNum, tc.m_colNum, (int)tc.m_merges.size(), (int)tbytes );
+			cells += (size_t)tc.m_rowNum * tc.m_colNum;
+			bytes += tbytes;
+			if( !verbose )
+				continue;
+			for( int r = 0; r < tc.m_rowNum; ++r ) {
+				printf( "   " );
+				for( int c = 0; c < tc.m_colNum; ++c ) {
+					std::string_view sv = tc.m_cols[c].Get( r );
+					printf( " |%s%.*s", tc.m_cols[c].m_covered[r] ? "^" : "", (int)sv.size(), sv.data() );
+				}
+				printf( "\n" );
+			}
+		}
+	}
+	printf( "dumptables: %d files, %d tables, %d cells, %d bytes, open %.2f ms, extract %.2f ms\n",
+		files, tablenum, (int)cells, (int)bytes, ms_open, ms_extract );
+	return 0;
+}
+
+class FileSink : public TextSink
+{
+public:
+	explicit FileSink( FILE * fp ) : m_fp( fp ) { }
+	int Write( const char * data, size_t len ) override { return fwrite( data, 1, len, m_fp ) == len ? (int)len : -1; }
+private:
+	FILE * m_fp;
+};
+
+static int dumptext( const char * fname, int threads )
+{
+	Document doc;
+	auto t0 = std::chrono::steady_clock::now();
+	int ret = doc.Open( fname );
+	if( ret < 0 ) {
+		fprintf( stderr, "[%s] open failed, ret %d\n", fname, ret );
+		return ret;
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	TextOption opt;
+	opt.m_threadNum = threads;
+	FileSink sink( stdout );
+	ret = doc.ExtractText( sink, opt );
+	auto t2 = std::chrono::steady_clock::now();
+	fprintf( stderr, "dumptext: ret %d, open %.2f ms, extract %.2f ms\n", ret,
+		std::chrono::duration<double, std::milli>( t1 - t0 ).count(), std::chrono::duration<double, std::milli>( t2 - t1 ).count() );
+	return ret;
+}
+
+// index build <dir> <file>... | index add <dir> <file>... | index query <dir> <text>...
+static int indexcmd( int argc, char * argv[] )
+{
+	const char * op = argv[0];
+	std::string dir = argv[1];
+	IndexReader reader;
+	int ret = reader.Open( dir );
+	if( ret < 0 ) {
+		printf( "index [%s] open failed, ret %d\n", dir.c_str(), ret );
+		return ret;
+	}
+
+	if( strcmp( op, "query" ) == 0 ) {
+		std::string text;
+		for( int i = 2; i < argc; ++i )
+			text.append( i > 2 ? " " : "" ).append( argv[i] );
+		std::vector<IndexHit> hits;
+		auto t0 = std::chrono::steady_clock::now();
+		ret = reader.Query( text, hits );
+		auto t1 = std::chrono::steady_clock::now();
+		for( const IndexHit & hit : hits ) {
+			std::string_view name = reader.GetDocName( hit.m_doc );
+			printf( "%.*s : element %u, pos %u\n", (int)name.size(), name.data(), hit.m_elem, hit.m_pos );
+		}
+		printf( "index query: [%s] %d hits in %d docs, %.3f ms\n", text.c_str(), ret, reader.GetDocNum(),
+			std::chrono::duration<double, std::milli>( t1 - t0 ).count() );
+		return ret;
+	}
+
+	bool add = ( strcmp( op, "add" ) == 0 );
+	if( !add && strcmp( op, "build" ) != 0 ) {
+		printf( "index: unknown op [%s]\n", op );
+		return -1;
+	}
+	if( !add && reader.GetSegmentNum() > 0 ) {
+		printf( "index [%s] already exist, use add\n", dir.c_str() );
+		return -1;
+	}
+	// one segment for every batch, bound writer memory
+	const int batch = 1000;
+	IndexWriter writer;
+	int added = 0, skipped = 0, failed = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	for( int i = 2; i < argc; ++i ) {
+		if( add && reader.FindDoc( argv[i] ) >= 0 ) {
+			++skipped;
+			continue;
+		}
+		if( writer.AddFile( argv[i] ) < 0 ) {
+			printf( "[%s] open failed\n", argv[i] );
+			++failed;
+			continue;
+		}
+		++added;
+		if( writer.GetDocNum() >= batch && ( ret = writer.Commit( dir ) ) < 0 )
+			break;
+	}
+	if( ret >= 0 && writer.GetDocNum() > 0 )
+		ret = writer.Commit( dir );
+	auto t1 = std::chrono::steady_clock::now();
+	printf( "index %s: %d added, %d skipped, %d failed, ret %d, %.2f ms\n", op, added, skipped, failed, ret,
+		std::chrono::duration<double, std::milli>( t1 - t0 ).count() );
+	return ret < 0 ? ret : 0;
+}
+
 static int newdoc( const char * fname )
 {
 	int ret;
@@ -737,96 +1086,1727 @@ static int t_table_2()
 	return 0;
 }
 
-static int conv( const char * fname )
+static int t_grid()
 {
-	// read file to char string
-	std::ifstream ifs( fname, std::ios::binary );
-	if( !ifs.is_open() ) {
-		printf( "can't open file %s\n", fname );
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+
+	// 6x6 table with span and vmerge
+	Table tbl = doc.AddChildTable();
+	tbl.Reset( 6, 6 );
+	TRow row0 = tbl.GetFirstChild();
+	TRow row1 = row0.GetNext();
+	TRow row2 = row1.GetNext();
+	row0.GetCell( 1 ).SetSpanNum( 2 );
+	row1.GetCell( 0 ).SetVMergeNum( 3 );
+	row2.GetCell( 2 ).SetSpanNum( 3 );
+	row2.GetCell( 5 ).SetVMergeNum( 4 );
+	SPDDebug::DropVMergeVal( tbl );
+
+	// grid should match the walking api for every position
+	int err = 0;
+	const TableGrid * grid = doc.GetTableGrid( tbl );
+	if( grid == nullptr || grid->GetRowNum() != 6 || grid->GetColNum() != 6 ) {
+		printf( "t_grid: GetTableGrid FAILED!\n" );
 		return -1;
 	}
-	ifs.seekg( 0, std::ios::end );
-	long len = ifs.tellg();
-	ifs.seekg( 0, std::ios::beg );
-	char * buf = new char[len + 1];
-	ifs.read( buf, len );
-	buf[len] = '\0';
-	ifs.close();
-
-	printf( "const char * const str = \n\"" );
-	long i;
-	for( i = 0; i < len; ++i )
-	{
-		uint8_t ch = (uint8_t)buf[i];
-		if( ch == '"' ) {
-			printf( "\\\"" );
-		}
-		else if( ch == '\r' ) {
-			printf( "\\r" );
-		}
-		else if( ch == '\n' ) {
-			printf( "\\n" );
-		}
-		else if( ch >= 32 && ch <= 126 ) {
-			printf( "%c", ch );
-		}
-		else {
-			printf( "\\x%02x", ch );
-		}
-		if( i % 120 == 119 )
-		{
-			printf( "\"\n\"" );
+	if( grid->GetOwner( 5, 5 ) == nullptr || grid->GetOwner( 5, 5 )->m_row != 2 || grid->GetOwner( 5, 5 )->m_rowSpan != 4 ) {
+		printf( "t_grid: vmerge without w:val not treat as continue\n" );
+		++err;
+	}
+	int r = 0;
+	for( TRow row = tbl.GetFirstChild(); row.IsValid(); row = row.GetNext(), ++r ) {
+		for( int c = 0; c < 6; ++c ) {
+			int firstcol = -1, span = -1;
+			TCell cell = row.GetCell( c, firstcol, span );
+			TCell start = cell.GetVMergeStartCell();
+			const TableGrid::CellInfo * info = grid->GetOwner( r, c );
+			if( info == nullptr || info->m_cell != start || info->m_col != firstcol
+					|| info->m_colSpan != span || info->m_rowSpan != start.GetVMergeNum() || grid->Find( cell ) != info ) {
+				printf( "t_grid: row %d col %d not match\n", r, c );
+				++err;
+			}
 		}
 	}
-	printf( "\";\n" );
 
-	delete [] buf, buf = nullptr;
+	// structure change rebuild the grid
+	row1.GetCell( 0 ).SetVMergeNum( 1 );
+	grid = doc.GetTableGrid( tbl );
+	const TableGrid::CellInfo * info = grid->GetOwner( 2, 0 );
+	if( info == nullptr || info->m_row != 2 || info->m_rowSpan != 1 ) {
+		printf( "t_grid: grid not rebuild after SetVMergeNum\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_grid: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_grid: VERIFY OK!\n" );
 	return 0;
 }
 
-static int usage()
+// every row should cover all grid columns
+static int check_cols( const Table & tbl, int colnum, const char * step )
 {
-	printf( "%s", R"(Usage: spdocxutil <cmd> <params>
-  usage | help        : show this usage
-  dumpinfo            : dump docx info
-  dumpdirjson         : dump docx dir in json
-  newdoc              : create new docx 
-  conv                : conv file to char string
-  t_table             : test table create/merge/verify
-  t_table_2           : test table merge modification (remove/increase/add)
-)" );
+	int err = 0;
+	if( tbl.GetColNum() != colnum || (int)tbl.GetColWidth().size() != colnum ) {
+		printf( "t_cols: %s colnum %d (expected %d)\n", step, tbl.GetColNum(), colnum );
+		++err;
+	}
+	int r = 0;
+	for( TRow row = tbl.GetFirstChild(); row.IsValid(); row = row.GetNext(), ++r ) {
+		int col = 0;
+		for( TCell cell = row.GetFirstChild(); cell.IsValid(); cell = cell.GetNext() )
+			col += cell.GetSpanNum();
+		if( col != colnum ) {
+			printf( "t_cols: %s row %d cover %d cols (expected %d)\n", step, r, col, colnum );
+			++err;
+		}
+	}
+	return err;
+}
+
+static int t_cols()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+
+	// 3x4 table, row0 col1~col2 span
+	Table tbl = doc.AddChildTable();
+	tbl.Reset( 3, 4 );
+	TRow row0 = tbl.GetFirstChild();
+	row0.GetCell( 1 ).SetSpanNum( 2 );
+
+	int err = 0;
+	// insert inside span, row0 span should be extended
+	if( tbl.AddCols( 2, 2 ) < 0 )
+		++err;
+	err += check_cols( tbl, 6, "AddCols(2, 2)" );
+	if( row0.GetCell( 1 ).GetSpanNum() != 4 ) {
+		printf( "t_cols: span %d after AddCols (expected 4)\n", row0.GetCell( 1 ).GetSpanNum() );
+		++err;
+	}
+	// insert at begin and end with width
+	if( tbl.AddCols( 0, 1, { 500 } ) < 0 || tbl.AddCol( 7 ) < 0 )
+		++err;
+	err += check_cols( tbl, 8, "AddCols(0, 1) AddCol(7)" );
+	if( tbl.GetColWidth( 0 ) != 500 )
+		++err;
+	// delete part of span and a normal column
+	if( tbl.DelCols( 2, 3 ) < 0 )
+		++err;
+	err += check_cols( tbl, 5, "DelCols(2, 3)" );
+	if( tbl.DelCol( 0 ) < 0 || tbl.DelCols( 0, 4 ) == 0 )
+		++err;
+	err += check_cols( tbl, 4, "DelCol(0)" );
+
+	if( err > 0 ) {
+		printf( "t_cols: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_cols: VERIFY OK!\n" );
 	return 0;
 }
 
-int main( int argc, char * argv[] )
+static int t_csv()
 {
-	if( argc < 2 ) {
-		usage();
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+
+	int err = 0;
+	Table tbl = doc.AddChildTable();
+	tbl.Fill( std::vector< std::vector<std::string> >{ { "a", "b,c", "say \"hi\"" }, { "x", "", "two\nline" }, { "1", "2", "3" } } );
+	std::string out;
+	StringSink sink( out );
+	tbl.ExportDelimited( sink );
+	const char * expect = "a,\"b,c\",\"say \"\"hi\"\"\"\r\nx,,\"two\nline\"\r\n1,2,3\r\n";
+	if( out != expect ) {
+		printf( "t_csv: export [%s] not match\n", out.c_str() );
+		++err;
+	}
+
+	// import the export, should get same content
+	Table tbl2 = doc.AddChildTable();
+	StringSource src( out );
+	int rows = tbl2.ImportDelimited( src );
+	std::string out2;
+	StringSink sink2( out2 );
+	tbl2.ExportDelimited( sink2 );
+	if( rows != 3 || tbl2.GetColNum() != 3 || out2 != out ) {
+		printf( "t_csv: import rows %d cols %d, export again [%s]\n", rows, tbl2.GetColNum(), out2.c_str() );
+		++err;
+	}
+
+	// merged cell as tsv, row0 col0~col1 span, col2 vmerge row0~row1
+	TRow row0 = tbl.GetFirstChild();
+	row0.GetCell( 0 ).SetSpanNum( 2 );
+	row0.GetCell( 2 ).SetVMergeNum( 2 );
+	DelimitedOption opt;
+	opt.m_delim = '\t';
+	opt.m_lineEnd = "\n";
+	out.clear();
+	tbl.ExportDelimited( sink, opt );
+	if( out != "a\t\t\"say \"\"hi\"\"\"\nx\t\t\n1\t2\t3\n" ) {
+		printf( "t_csv: export empty merged [%s] not match\n", out.c_str() );
+		++err;
+	}
+	opt.m_merged = MergedCellE::REPEAT;
+	out.clear();
+	tbl.ExportDelimited( sink, opt );
+	if( out != "a\ta\t\"say \"\"hi\"\"\"\nx\t\t\"say \"\"hi\"\"\"\n1\t2\t3\n" ) {
+		printf( "t_csv: export repeat merged [%s] not match\n", out.c_str() );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_csv: VERIFY FAILED with %d error(s)!\n", err );
 		return -1;
 	}
+	printf( "t_csv: VERIFY OK!\n" );
+	return 0;
+}
 
-	spd::SPD_SetLogLevel( SPD_LOG_LEVEL_DEBUG );
-	SPD_PR_INFO( "hello %d", 5 );
+static int t_rows()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+
+	// 8x3 table, vmerge col0 row1~row5, col1 row0~row2, col2 row4~row7
+	Table tbl = doc.AddChildTable();
+	tbl.Reset( 8, 3 );
+	TRow row0 = tbl.GetFirstChild();
+	TRow row1 = row0.GetNext();
+	TRow row4 = row1.GetNext().GetNext().GetNext();
+	row1.GetCell( 0 ).SetVMergeNum( 5 );
+	row0.GetCell( 1 ).SetVMergeNum( 3 );
+	row4.GetCell( 2 ).SetVMergeNum( 4 );
+
+	int err = 0;
+	// del row2~row4, col0 join, col1 shrink, col2 restart at old row5
+	if( tbl.DelRows( 2, 3 ) < 0 || tbl.GetRowNum() != 5 )
+		++err;
+	TableGrid grid;
+	grid.Build( tbl );
+	const TableGrid::CellInfo * info0 = grid.GetOwner( 2, 0 );
+	const TableGrid::CellInfo * info1 = grid.GetOwner( 1, 1 );
+	const TableGrid::CellInfo * info2 = grid.GetOwner( 4, 2 );
+	if( info0 == nullptr || info0->m_row != 1 || info0->m_rowSpan != 2 ) {
+		printf( "t_rows: col0 merge not join\n" );
+		++err;
+	}
+	if( info1 == nullptr || info1->m_row != 0 || info1->m_rowSpan != 2 ) {
+		printf( "t_rows: col1 merge not shrink\n" );
+		++err;
+	}
+	if( info2 == nullptr || info2->m_row != 2 || info2->m_rowSpan != 3 || info2->m_cell.GetVMergeType() != VMergeTypeE::START ) {
+		printf( "t_rows: col2 merge not restart\n" );
+		++err;
+	}
 
-	if( strcmp( argv[1], "dumpinfo" ) == 0 && argc >= 3 ) {
-		dumpinfo( argv[2] );
-		//char utf8_string[] = "\xE4\xB8\xAD\xE6\x96\x87.docx"; // 中文.docx
-		//dumpinfo( utf8_string );
+	// del first 2 row, col0 and col1 merge is gone
+	if( tbl.DelRows( 0, 2 ) < 0 || tbl.DelRows( 2, 2 ) == 0 )
+		++err;
+	row0 = tbl.GetFirstChild();
+	if( row0.GetCell( 0 ).GetVMergeType() != VMergeTypeE::NONE || row0.GetCell( 1 ).GetVMergeType() != VMergeTypeE::NONE
+			|| row0.GetCell( 2 ).GetVMergeNum() != 3 ) {
+		printf( "t_rows: merge after del first rows not match\n" );
+		++err;
 	}
-	else if( strcmp( argv[1], "dumpdirjson" ) == 0 && argc >= 3 ) {
-		dumpdirjson( argv[2] );
+
+	if( err > 0 ) {
+		printf( "t_rows: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
 	}
-	else if( strcmp( argv[1], "newdoc" ) == 0 && argc >= 3 ) {
-		newdoc( argv[2] );
+	printf( "t_rows: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_repair()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	doc.AddChildParagraph();
+	Table tbl = doc.AddChildTable();
+	tbl.Reset( 3, 3 );
+	Table good = doc.AddChildTable();
+	good.Reset( 2, 2 );
+	SPDDebug::CorruptTable( tbl );
+
+	int err = 0;
+	std::vector<TableIssue> issues;
+	int num = doc.ValidateTables( &issues );
+	// BAD_SPAN, BAD_VMERGE + ORPHAN_CONT, SHORT_ROW, EMPTY_CELL, GRID_COL_NUM
+	if( num != 6 || (int)issues.size() != num || good.Validate() != 0 ) {
+		printf( "t_repair: validate found %d issue, expect 6\n", num );
+		++err;
 	}
-	else if( strcmp( argv[1], "conv" ) == 0 && argc >= 3 ) {
-		conv( argv[2] );
+	for( const TableIssue & issue : issues ) {
+		if( issue.m_table != 0 )
+			++err;
 	}
-	else if( strcmp( argv[1], "t_table" ) == 0 ) {
-		t_table();
+	if( doc.RepairTables() != num || doc.ValidateTables() != 0 ) {
+		printf( "t_repair: issue left after repair\n" );
+		++err;
 	}
-	else if( strcmp( argv[1], "t_table_2" ) == 0 ) {
-		t_table_2();
+	TableGrid grid;
+	grid.Build( tbl );
+	if( tbl.GetColNum() != 3 || grid.GetRowNum() != 3 || grid.GetColNum() != 3
+			|| grid.GetCell( 1, 1 ).GetVMergeType() != VMergeTypeE::START || grid.GetCell( 2, 2 ).GetSpanNum() != 1 ) {
+		printf( "t_repair: table after repair not match\n" );
+		++err;
+	}
+
+	// continue written by Word without w:val is not an issue, and repair keep it
+	Table word = doc.AddChildTable();
+	word.Reset( 3, 2 );
+	TRow wrow = word.GetFirstChild();
+	wrow.GetCell( 1 ).SetVMergeNum( 3 );
+	SPDDebug::DropVMergeVal( word );
+	if( word.Validate() != 0 || word.Repair() != 0 || doc.ValidateTables() != 0
+			|| TRow( wrow.GetNext() ).GetCell( 1 ).GetVMergeType() != VMergeTypeE::CONT
+			|| wrow.GetCell( 1 ).GetVMergeNum() != 3 ) {
+		printf( "t_repair: vmerge without w:val reported as issue\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_repair: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_repair: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_text()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+
+	Paragraph par = doc.AddChildParagraph();
+	par.AddChildRun().SetText( "Head" );
+	par = doc.AddChildParagraph();
+	par.AddChildHyperlink().AddChildRun().SetText( "link" );
+	par.AddChildRun().SetText( "x" );
+	Table tbl = doc.AddChildTable();
+	tbl.Fill( std::vector< std::vector<std::string> >{ { "a", "b\nc" }, { "d", "" } } );
+	std::string expect = "Head\nlinkx\na\tb\nc\nd\t\n";
+	for( int i = 0; i < 1000; ++i ) {
+		std::string text = "p" + std::to_string( i );
+		doc.AddChildParagraph().AddChildRun().SetText( text.c_str() );
+		expect += text + "\n";
+	}
+
+	int err = 0;
+	TextOption opt;
+	opt.m_threadNum = 1;
+	std::string serial;
+	StringSink sink( serial );
+	if( doc.ExtractText( sink, opt ) != SPD_ERR_OK || serial != expect ) {
+		printf( "t_text: serial text not match, size %d expect %d\n", (int)serial.size(), (int)expect.size() );
+		++err;
+	}
+	// slice boundary fall on table and paragraph
+	for( int threads = 2; threads <= 8; threads *= 2 ) {
+		opt.m_threadNum = threads;
+		opt.m_minSlice = 1;
+		std::string parallel;
+		StringSink psink( parallel );
+		if( doc.ExtractText( psink, opt ) != SPD_ERR_OK || parallel != serial ) {
+			printf( "t_text: %d thread text not match serial\n", threads );
+			++err;
+		}
+	}
+
+	if( err > 0 ) {
+		printf( "t_text: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_text: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_replace()
+{
+	int err = 0;
+	// fail link and leftmost longest
+	TextReplacer ac;
+	ac.Add( "he", "Y" );
+	ac.Add( "she", "X" );
+	ac.Add( "his", "H" );
+	ac.Add( "hers", "Z" );
+	ac.Build();
+	std::string out;
+	if( ac.ReplaceAll( "ushers, his hers", out ) != 3 || out != "uXrs, H Z" ) {
+		printf( "t_replace: ReplaceAll [%s] not match\n", out.c_str() );
+		++err;
+	}
+
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	// placeholder split by run with different format
+	Paragraph par = doc.AddChildParagraph();
+	par.AddChildRun().SetText( "Dear {{cus" );
+	Run r2 = par.AddChildRun();
+	r2.SetText( "tomer_" );
+	r2.SetBold();
+	Run r3 = par.AddChildRun();
+	r3.SetText( "name}} on {{date}}" );
+	r3.SetItalic();
+	par.AddChildRun().SetText( "!" );
+	Table tbl = doc.AddChildTable();
+	tbl.Fill( std::vector< std::vector<std::string> >{ { "{{date}}", "{{customer_name}}{{date}}" } } );
+
+	TextReplacer rep;
+	rep.Add( "{{customer_name}}", "Alice" );
+	rep.Add( "{{date}}", "today" );
+	rep.Add( "{{unused}}", "" );
+	rep.Build();
+	int num = doc.Replace( rep );
+	if( num != 5 || par.GetText() != "Dear Alice on today!" ) {
+		printf( "t_replace: replace %d, text [%s] not match\n", num, par.GetText().c_str() );
+		++err;
+	}
+	int runs = 0;
+	for( Run run : par.Children<Run>() ) {
+		if( runs == 0 && run.GetBold() )
+			++err;
+		++runs;
+	}
+	if( runs != 3 ) {
+		printf( "t_replace: %d run left, expect 3\n", runs );
+		++err;
+	}
+	if( TRow( tbl.GetFirstChild() ).GetCell( 1 ).GetText() != "Alicetoday" ) {
+		printf( "t_replace: cell text not replaced\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_replace: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_replace: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_find()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	doc.AddChildParagraph().AddChildRun().SetText( "Hello world" );
+	Paragraph par = doc.AddChildParagraph();
+	Run r1 = par.AddChildRun();
+	r1.SetText( "foo Ba" );
+	Run r2 = par.AddChildRun();
+	r2.SetText( "r baz" );
+	Table tbl = doc.AddChildTable();
+	tbl.Fill( std::vector< std::vector<std::string> >{ { "hello, World!", "helloworld" } } );
+
+	int err = 0;
+	std::vector<FindResult> res;
+	FindOption opt;
+	if( doc.Find( "world", res, opt ) != 2 ) {
+		printf( "t_find: case sensitive find %d, expect 2\n", (int)res.size() );
+		++err;
+	}
+	opt.m_ignoreCase = true;
+	if( doc.Find( "WORLD", res, opt ) != 3 ) {
+		printf( "t_find: ignore case find %d, expect 3\n", (int)res.size() );
+		++err;
+	}
+	opt.m_wholeWord = true;
+	if( doc.Find( "hello", res, opt ) != 2 || doc.Find( "hell", res, opt ) != 0 ) {
+		printf( "t_find: whole word not match\n" );
+		++err;
+	}
+	// span run
+	opt.m_wholeWord = false;
+	if( doc.Find( "bar", res, opt ) != 1 || res[0].m_offset != 4 || res[0].m_runOffset != 4 || res[0].m_endOffset != 1
+			|| res[0].m_run.GetText() != "foo Ba" || res[0].m_endRun.GetText() != "r baz" || res[0].m_par.GetText() != "foo Bar baz" ) {
+		printf( "t_find: cross run result not match\n" );
+		++err;
+	}
+	opt.m_crossRun = false;
+	if( doc.Find( "bar", res, opt ) != 0 ) {
+		printf( "t_find: match span run when not allowed\n" );
+		++err;
+	}
+	opt.m_maxResult = 1;
+	if( doc.Find( "o", res, opt ) != 1 ) {
+		printf( "t_find: max result not limit\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_find: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_find: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_style()
+{
+	Document doc;
+	doc.New();
+
+	int err = 0;
+	StyleLite st;
+	st.m_id = "MyHead";
+	st.m_type = "paragraph";
+	st.m_name = "My Heading";
+	doc.AddStyle( st );
+	if( strcmp( doc.GetStyleId( "My Heading" ), "MyHead" ) != 0 || strcmp( doc.GetStyleId( "my HEADING", true ), "MyHead" ) != 0
+			|| doc.GetStyleId( "my heading" )[0] != '\0' || doc.GetStyle( std::string_view( "MyHead" ) ) == nullptr ) {
+		printf( "t_style: name lookup not match\n" );
+		++err;
+	}
+	// rename
+	st.m_name = "Renamed";
+	doc.AddStyle( st );
+	if( doc.GetStyleByName( "My Heading" ) != nullptr || doc.GetStyleByName( "renamed", true ) != doc.GetStyle( "MyHead" ) ) {
+		printf( "t_style: rename not update index\n" );
+		++err;
+	}
+	// duplicated name, first in id order win, the other take place after rename
+	st.m_name = "dup";
+	st.m_id = "DupB";
+	doc.AddStyle( st );
+	st.m_id = "DupA";
+	doc.AddStyle( st );
+	if( strcmp( doc.GetStyleId( "dup" ), "DupA" ) != 0 ) {
+		printf( "t_style: duplicated name not first id\n" );
+		++err;
+	}
+	st.m_name = "other";
+	doc.AddStyle( st );
+	if( strcmp( doc.GetStyleId( "DUP", true ), "DupB" ) != 0 || strcmp( doc.GetStyleId( "other" ), "DupA" ) != 0 ) {
+		printf( "t_style: duplicated name not restored after rename\n" );
+		++err;
+	}
+	// name shared only in case, the other take place of ignore case index
+	st.m_name = "DUP";
+	st.m_id = "DupC";
+	doc.AddStyle( st );
+	st.m_name = "single";
+	st.m_id = "DupB";
+	doc.AddStyle( st );
+	if( strcmp( doc.GetStyleId( "dup", true ), "DupC" ) != 0 || doc.GetStyleId( "dup" )[0] != '\0'
+			|| strcmp( doc.GetStyleId( "SINGLE", true ), "DupB" ) != 0 ) {
+		printf( "t_style: name shared in case not restored after rename\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_style: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_style: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_format()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+
+	StyleLite base;
+	base.m_id = "TBase";
+	base.m_type = "paragraph";
+	base.m_name = "t base";
+	base.m_format.m_align = "center";
+	base.m_format.m_mask |= ParaFormat::ALIGN;
+	base.m_format.m_run.m_bold = true;
+	base.m_format.m_run.m_size = 24;
+	base.m_format.m_run.m_mask |= RunFormat::BOLD | RunFormat::SIZE;
+	doc.AddStyle( base );
+	StyleLite child;
+	child.m_id = "TChild";
+	child.m_type = "paragraph";
+	child.m_name = "t child";
+	child.m_basedOn = "TBase";
+	child.m_format.m_align = "left";
+	child.m_format.m_mask |= ParaFormat::ALIGN;
+	child.m_format.m_run.m_italic = true;
+	child.m_format.m_run.m_color = "FF0000";
+	child.m_format.m_run.m_mask |= RunFormat::ITALIC | RunFormat::COLOR;
+	doc.AddStyle( child );
+
+	Paragraph par = doc.AddChildParagraph();
+	par.SetStyleId( "TChild" );
+	Run run = par.AddChildRun();
+	run.SetText( "styled" );
+	run.SetColor( "00FF00" );
+
+	int err = 0;
+	RunFormat rf = run.GetEffectiveFormat( doc );
+	if( !rf.m_bold || !rf.m_italic || rf.m_size != 24 || rf.m_color != "00FF00" ) {
+		printf( "t_format: run format not match, bold %d italic %d size %d color %s\n", rf.m_bold, rf.m_italic, rf.m_size, rf.m_color.c_str() );
+		++err;
+	}
+	ParaFormat pf = par.GetEffectiveFormat( doc );
+	if( pf.m_align != "left" || pf.m_run.m_color != "FF0000" ) {
+		printf( "t_format: paragraph format not match\n" );
+		++err;
+	}
+	if( &doc.GetStyleFormat( "TChild" ) != &doc.GetStyleFormat( "TChild" ) ) {
+		printf( "t_format: style format not memoized\n" );
+		++err;
+	}
+	// change of base reach child
+	base.m_format.m_run.m_size = 30;
+	doc.AddStyle( base );
+	if( run.GetEffectiveFormat( doc ).m_size != 30 ) {
+		printf( "t_format: base change not applied\n" );
+		++err;
+	}
+
+	// styles.xml of docDefaults and basedOn chain, loaded by Open()
+	static const char s_styles[] = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<w:styles xmlns:w="http://schemas.openxmlformats.org/wordprocessingml/2006/main">
+<w:docDefaults><w:rPrDefault><w:rPr><w:rFonts w:ascii="Calibri"/><w:sz w:val="21"/></w:rPr></w:rPrDefault>
+<w:pPrDefault><w:pPr><w:spacing w:after="160"/></w:pPr></w:pPrDefault></w:docDefaults>
+<w:style w:type="paragraph" w:default="1" w:styleId="Normal"><w:name w:val="Normal"/><w:pPr><w:jc w:val="both"/></w:pPr></w:style>
+<w:style w:type="paragraph" w:styleId="Heading1"><w:name w:val="heading 1"/><w:basedOn w:val="Normal"/>
+<w:pPr><w:spacing w:before="240"/></w:pPr><w:rPr><w:b/><w:sz w:val="32"/></w:rPr></w:style>
+<w:style w:type="paragraph" w:styleId="Heading2"><w:name w:val="heading 2"/><w:basedOn w:val="Heading1"/>
+<w:rPr><w:i/><w:color w:val="2F5496"/></w:rPr></w:style>
+<w:style w:type="character" w:styleId="Strong"><w:name w:val="Strong"/><w:rPr><w:b/></w:rPr></w:style>
+<w:style w:type="character" w:styleId="StrongEm"><w:name w:val="Strong Em"/><w:basedOn w:val="Strong"/><w:rPr><w:b w:val="0"/><w:i/></w:rPr></w:style>
+</w:styles>)";
+	Document sdoc;
+	sdoc.New();
+	sdoc.DelAllChild();
+	sdoc.SetEmbedData( "styles.xml", std::vector<char>( s_styles, s_styles + sizeof( s_styles ) - 1 ) );
+	Paragraph hpar = sdoc.AddChildParagraph();
+	hpar.SetStyleId( "Heading2" );
+	hpar.AddChildRun().SetText( "plain" );
+	Run strong = hpar.AddChildRun();
+	strong.SetText( "strong" );
+	SPDDebug::SetRunStyle( strong, "Strong" );
+	Run em = hpar.AddChildRun();
+	em.SetText( "em" );
+	SPDDebug::SetRunStyle( em, "StrongEm" );
+	Run direct = hpar.AddChildRun();
+	direct.SetText( "direct" );
+	direct.SetBold( true );
+	SPDDebug::SetRunStyle( direct, "Strong" );
+	Run nstrong = sdoc.AddChildParagraph().AddChildRun();
+	nstrong.SetText( "normal strong" );
+	SPDDebug::SetRunStyle( nstrong, "Strong" );
+	Document ldoc;
+	if( sdoc.Save( "t_format.docx" ) != SPD_ERR_OK || ldoc.Open( "t_format.docx" ) != SPD_ERR_OK ) {
+		printf( "t_format: save and open styles FAILED!\n" );
+		return -1;
+	}
+	remove( "t_format.docx" );
+
+	// paragraph style chain over docDefaults and default paragraph style
+	hpar = ldoc.GetElementAt( 0 );
+	pf = hpar.GetEffectiveFormat( ldoc );
+	if( pf.m_align != "both" || pf.m_spaceBefore != 240 || pf.m_spaceAfter != 160 || !pf.m_run.m_bold || !pf.m_run.m_italic
+			|| pf.m_run.m_size != 32 || pf.m_run.m_font != "Calibri" || pf.m_run.m_color != "2F5496" ) {
+		printf( "t_format: loaded paragraph style not match\n" );
+		++err;
+	}
+	if( ldoc.GetStyleFormat( "" ).m_align != "both" || ldoc.GetStyleFormat( "" ).m_run.m_size != 21 ) {
+		printf( "t_format: default paragraph style not match\n" );
+		++err;
+	}
+	// toggle of character style xor paragraph style, chain inside character style and direct format overwrite
+	bool expect[][2] = { { true, true }, { false, true }, { true, false }, { true, true } };
+	int i = 0;
+	for( Run r : hpar.Children<Run>() ) {
+		rf = r.GetEffectiveFormat( ldoc );
+		if( i >= 4 || rf.m_bold != expect[i][0] || rf.m_italic != expect[i][1] || rf.m_size != 32 ) {
+			printf( "t_format: run %d of heading toggle not match, bold %d italic %d\n", i, rf.m_bold, rf.m_italic );
+			++err;
+		}
+		++i;
+	}
+	rf = Run( Paragraph( ldoc.GetElementAt( 1 ) ).GetFirstChild() ).GetEffectiveFormat( ldoc );
+	if( i != 4 || !rf.m_bold || rf.m_italic || rf.m_size != 21 ) {
+		printf( "t_format: strong in normal paragraph not match\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_format: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_format: VERIFY OK!\n" );
+	return 0;
+}
+
+static void index_doc( IndexWriter & writer, const char * name, const std::vector<const char *> & paras, const char * cell0 = nullptr, const char * cell1 = nullptr )
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	for( const char * text : paras )
+		doc.AddChildParagraph().AddChildRun().SetText( text );
+	if( cell0 != nullptr )
+		doc.AddChildTable().Fill( std::vector< std::vector<std::string> >{ { cell0, cell1 } } );
+	writer.AddDocument( name, doc );
+}
+
+static int t_index()
+{
+	const std::string dir = "t_index.dir";
+	std::vector<int> segs;
+	IndexReader::ListSegment( dir, segs );
+	for( int no : segs )
+		remove( IndexReader::GetSegmentName( dir, no ).c_str() );
+
+	// two segment, doc 2 is in second segment with doc base 2
+	IndexWriter writer;
+	index_doc( writer, "d0", { "alpha beta", "\xE2\x80\x9C" "Beta\xE2\x80\x9D gamma alpha" } );
+	index_doc( writer, "d1", { "gamma" }, "beta x", "alpha beta" );
+	int err = 0;
+	if( writer.Commit( dir ) < 0 ) {
+		printf( "t_index: first commit FAILED!\n" );
+		return -1;
+	}
+	index_doc( writer, "d2", { "x", "y", "beta alpha beta" } );
+	if( writer.Commit( dir ) < 0 ) {
+		printf( "t_index: second commit FAILED!\n" );
+		return -1;
+	}
+
+	IndexReader reader;
+	if( reader.Open( dir ) != 2 || reader.GetDocNum() != 3 || reader.FindDoc( "d2" ) != 2 || reader.GetDocName( 1 ) != "d1" ) {
+		printf( "t_index: reopen index not match\n" );
+		++err;
+	}
+	// hit of doc delta, elem delta and pos delta, table cell continue position with one gap after cell
+	auto same = []( const std::vector<IndexHit> & hits, const std::vector<IndexHit> & expect ) {
+		if( hits.size() != expect.size() )
+			return false;
+		for( size_t i = 0; i < hits.size(); ++i ) {
+			if( hits[i].m_doc != expect[i].m_doc || hits[i].m_elem != expect[i].m_elem || hits[i].m_pos != expect[i].m_pos )
+				return false;
+		}
+		return true;
+	};
+	std::vector<IndexHit> hits;
+	reader.Find( "beta", hits );
+	if( !same( hits, { { 0, 0, 1 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 1, 4 }, { 2, 2, 0 }, { 2, 2, 2 } } ) ) {
+		printf( "t_index: find beta not match, %d hits\n", (int)hits.size() );
+		++err;
+	}
+	// phrase is consecutive only, beta gamma alpha of d0 not match
+	reader.Query( "Alpha  BETA", hits );
+	if( !same( hits, { { 0, 0, 0 }, { 1, 1, 3 }, { 2, 2, 1 } } ) ) {
+		printf( "t_index: query alpha beta not match, %d hits\n", (int)hits.size() );
+		++err;
+	}
+	reader.Query( "beta alpha", hits );
+	if( !same( hits, { { 2, 2, 0 } } ) || reader.Find( "gamma\xE2\x80\x9D", hits ) != 0 ) {
+		printf( "t_index: query beta alpha not match\n" );
+		++err;
+	}
+	// phrase never span two cell, x end cell 0 and alpha begin cell 1 of d1
+	if( reader.Query( "x alpha", hits ) != 0 || reader.Query( "beta x", hits ) != 1 ) {
+		printf( "t_index: query across cell not match\n" );
+		++err;
+	}
+	reader.Close();
+
+	// truncated segment is rejected
+	std::string fname = IndexReader::GetSegmentName( dir, 2 );
+	std::string data;
+	FILE * fp = fopen( fname.c_str(), "rb" );
+	if( fp != nullptr ) {
+		char buf[4096];
+		for( size_t n = fread( buf, 1, sizeof( buf ), fp ); n > 0; n = fread( buf, 1, sizeof( buf ), fp ) )
+			data.append( buf, n );
+		fclose( fp );
+	}
+	fp = fopen( fname.c_str(), "wb" );
+	if( data.size() < 2 || fp == nullptr ) {
+		printf( "t_index: read segment FAILED!\n" );
+		++err;
+	}
+	else {
+		fwrite( data.data(), 1, data.size() - 2, fp );
+		fclose( fp );
+		if( reader.Open( dir ) >= 0 ) {
+			printf( "t_index: truncated segment opened\n" );
+			++err;
+		}
+	}
+
+	if( err > 0 ) {
+		printf( "t_index: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_index: VERIFY OK!\n" );
+	return 0;
+}
+
+static std::string read_file( const std::string & fname )
+{
+	std::ifstream ifs( fname, std::ios::binary );
+	return std::string( std::istreambuf_iterator<char>( ifs ), std::istreambuf_iterator<char>() );
+}
+
+// reopen saved file, text and xml match the document in memory
+static int save_match( const Document & doc, const char * fname )
+{
+	Document re;
+	if( re.Open( fname ) != SPD_ERR_OK ) {
+		printf( "t_save: reopen [%s] FAILED!\n", fname );
+		return 1;
+	}
+	TextOption opt;
+	opt.m_threadNum = 1;
+	std::string text, retext;
+	StringSink sink( text ), resink( retext );
+	doc.ExtractText( sink, opt );
+	re.ExtractText( resink, opt );
+	if( text != retext || SPDDebug::DocumentXml( doc ) != SPDDebug::DocumentXml( re ) ) {
+		printf( "t_save: [%s] not match document in memory\n", fname );
+		return 1;
+	}
+	return 0;
+}
+
+static int t_save()
+{
+	Document src;
+	src.New();
+	src.DelAllChild();
+	for( int i = 0; i < 10; ++i ) {
+		std::string text = "para " + std::to_string( i );
+		src.AddChildParagraph().AddChildRun().SetText( text.c_str() );
+	}
+	src.AddChildTable().Fill( std::vector< std::vector<std::string> >{ { "a", "b" }, { "c", "d" } } );
+	src.AddChildParagraph().AddChildRun().SetText( "tail" );
+	Document doc;
+	if( src.Save( "t_save_src.docx" ) != SPD_ERR_OK || doc.Open( "t_save_src.docx" ) != SPD_ERR_OK || !SPDDebug::HasBodyRange( doc ) ) {
+		printf( "t_save: open source FAILED!\n" );
+		return -1;
+	}
+
+	// no change is plain copy of source
+	int err = 0;
+	if( doc.Save( "t_save_copy.docx" ) != SPD_ERR_OK || read_file( "t_save_copy.docx" ) != read_file( "t_save_src.docx" ) ) {
+		printf( "t_save: unchanged save not same as source\n" );
+		++err;
+	}
+
+	// edit middle paragraph, insert and delete top level element, untouched child keep original bytes
+	Paragraph mid = doc.GetElementAt( 5 );
+	Run( mid.GetFirstChild() ).SetText( "edited" );
+	mid.AddSiblingParagraph().AddChildRun().SetText( "inserted" );
+	Element del = doc.GetElementAt( 2 );
+	doc.DelChild( del );
+	if( doc.Save( "t_save_1.docx" ) != SPD_ERR_OK || !SPDDebug::HasBodyRange( doc ) ) {
+		printf( "t_save: first save not splice\n" );
+		++err;
+	}
+	err += save_match( doc, "t_save_1.docx" );
+	// second save splice from buffer written by first save
+	Element first = doc.GetElementAt( 0 );
+	doc.DelChild( first );
+	Paragraph( doc.GetElementAt( 3 ) ).AddSiblingParagraph( false ).AddChildRun().SetText( "before" );
+	doc.AddChildParagraph( false ).AddChildRun().SetText( "head" );
+	if( doc.Save( "t_save_2.docx" ) != SPD_ERR_OK || !SPDDebug::HasBodyRange( doc ) ) {
+		printf( "t_save: second save not splice\n" );
+		++err;
+	}
+	err += save_match( doc, "t_save_2.docx" );
+
+	// body child offset not match source, fall back to full serialization
+	Document fb;
+	fb.Open( "t_save_src.docx" );
+	if( SPDDebug::BreakBodyRange( fb ) == SPD_ERR_OK || SPDDebug::HasBodyRange( fb ) ) {
+		printf( "t_save: broken offset not detected\n" );
+		++err;
+	}
+	Run( Paragraph( fb.GetElementAt( 4 ) ).GetFirstChild() ).SetText( "fallback" );
+	if( fb.Save( "t_save_3.docx" ) != SPD_ERR_OK ) {
+		printf( "t_save: fallback save FAILED!\n" );
+		++err;
+	}
+	err += save_match( fb, "t_save_3.docx" );
+
+	const char * files[] = { "t_save_src.docx", "t_save_copy.docx", "t_save_1.docx", "t_save_2.docx", "t_save_3.docx" };
+	for( const char * fname : files )
+		remove( fname );
+	if( err > 0 ) {
+		printf( "t_save: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_save: VERIFY OK!\n" );
+	return 0;
+}
+
+// index match a fresh walk of body, range and split cover all Element in order
+static int check_elem_index( const Document & doc, const char * step )
+{
+	std::vector<Element> walk;
+	for( Element ele : doc.Children() )
+		walk.push_back( ele );
+	int err = 0;
+	if( doc.GetElementCount() != (int)walk.size() )
+		++err;
+	for( int i = 0; err == 0 && i < (int)walk.size(); ++i ) {
+		if( doc.GetElementAt( i ) != walk[i] )
+			++err;
+	}
+	if( doc.GetElementAt( -1 ).IsValid() || doc.GetElementAt( (int)walk.size() ).IsValid() )
+		++err;
+	int first = (int)walk.size() / 3, k = 0;
+	for( Element ele : doc.GetElementRange( first, 10 ) ) {
+		if( first + k >= (int)walk.size() || ele != walk[first + k] )
+			++err;
+		++k;
+	}
+	if( k != std::min( 10, (int)walk.size() - first ) )
+		++err;
+	k = 0;
+	for( const ElementRange & range : doc.SplitElementRange( 7 ) ) {
+		for( Element ele : range ) {
+			if( k >= (int)walk.size() || ele != walk[k] )
+				++err;
+			++k;
+		}
+	}
+	if( k != (int)walk.size() )
+		++err;
+	if( err > 0 )
+		printf( "t_elem: index not match after %s\n", step );
+	return err;
+}
+
+static int t_elem()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	for( int i = 0; i < 100; ++i ) {
+		doc.AddChildParagraph().AddChildRun().SetText( "p" );
+		if( i % 20 == 10 )
+			doc.AddChildTable().Reset( 2, 2 );
+	}
+	int err = check_elem_index( doc, "build" );
+
+	// single middle edit is updated in place
+	Paragraph( doc.GetElementAt( 30 ) ).AddSiblingParagraph();
+	Paragraph( doc.GetElementAt( 40 ) ).AddSiblingTable( false );
+	Element del = doc.GetElementAt( 50 );
+	doc.DelChild( del );
+	doc.AddChildParagraph();
+	if( !SPDDebug::ElemIndexValid( doc ) ) {
+		printf( "t_elem: index not kept after single edit\n" );
+		++err;
+	}
+	err += check_elem_index( doc, "single edit" );
+
+	// bulk middle edit drop the index, rebuild on next lookup
+	Paragraph mid = doc.GetElementAt( 60 );
+	for( int i = 0; i < 40; ++i )
+		mid.AddSiblingParagraph();
+	for( int i = 0; i < 30; ++i ) {
+		Element ele = mid.GetNext();
+		doc.DelChild( ele );
+	}
+	err += check_elem_index( doc, "bulk edit" );
+	// lookup between middle edit is read only, edit still count to the rebuild
+	for( int i = 0; i < 2 * SPDDebug::MaxElemIndexEdit(); ++i ) {
+		mid.AddSiblingParagraph();
+		doc.GetElementAt( doc.GetElementCount() / 2 );
+	}
+	if( SPDDebug::ElemIndexValid( doc ) ) {
+		printf( "t_elem: lookup reset the edit count\n" );
+		++err;
+	}
+	err += check_elem_index( doc, "edit with lookup" );
+	// first child and last child
+	Element head = doc.GetElementAt( 0 );
+	doc.DelChild( head );
+	doc.AddChildParagraph( false );
+	Element tail = doc.GetElementAt( doc.GetElementCount() - 1 );
+	doc.DelChild( tail );
+	err += check_elem_index( doc, "head and tail edit" );
+
+	if( err > 0 ) {
+		printf( "t_elem: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_elem: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_query()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	for( int i = 0; i < 20; ++i )
+		doc.AddChildParagraph().AddChildRun().SetText( i % 5 == 0 ? "Total" : "item" );
+	Table tbl = doc.AddChildTable();
+	tbl.Fill( std::vector< std::vector<std::string> >{ { "Name", "Total" }, { "a", "1" } } );
+	doc.AddChildTable().Fill( std::vector< std::vector<std::string> >{ { "Name", "Sum" }, { "Total", "1" } } );
+
+	// same as walk of body
+	int err = 0;
+	std::vector<Paragraph> paras;
+	std::vector<Paragraph> walk;
+	for( Paragraph par : doc.Children<Paragraph>() )
+		walk.push_back( par );
+	if( doc.Query( "w:p", paras ) != (int)walk.size() || paras != walk ) {
+		printf( "t_query: top level paragraph not match walk\n" );
+		++err;
+	}
+	std::vector<Table> tables;
+	if( doc.Query( "w:tbl[w:tr[1]//w:t[contains(., 'Total')]]", tables ) != 1 || tables[0] != tbl ) {
+		printf( "t_query: table of header not match\n" );
+		++err;
+	}
+	// relative to ctx, typed result skip other type, text node is not Element
+	std::vector<TCell> cells;
+	std::vector<Element> eles;
+	if( doc.Query( ".//w:tc", cells, tbl ) != 4 || doc.Query( ".//w:tc", paras, tbl ) != 0
+			|| doc.Query( "//w:t/text()", eles ) != 0 || doc.Query( "w:p[w:r/w:t = 'Total']", eles ) != 4 ) {
+		printf( "t_query: ctx or typed query not match\n" );
+		++err;
+	}
+
+	// compiled query is cached once, bad and non node set query fail every time
+	int cached = SPDDebug::QueryCacheSize( doc );
+	if( doc.Query( "w:p", paras ) != (int)walk.size() || doc.Query( "w:p[", eles ) >= 0 || doc.Query( "w:p[", eles ) >= 0
+			|| doc.Query( "count(w:p)", eles ) != SPD_ERR_BAD_PARAM || SPDDebug::QueryCacheSize( doc ) != cached + 2 ) {
+		printf( "t_query: query cache not match\n" );
+		++err;
+	}
+	// cached query see later edit
+	doc.AddChildParagraph().AddChildRun().SetText( "Total" );
+	if( doc.Query( "w:p[w:r/w:t = 'Total']", eles ) != 5 || SPDDebug::QueryCacheSize( doc ) != cached + 2 ) {
+		printf( "t_query: cached query not see edit\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_query: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_query: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_elemid()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	for( int i = 0; i < 20; ++i )
+		doc.AddChildParagraph().AddChildRun().SetText( "p" );
+	Table tbl = doc.AddChildTable();
+	tbl.Reset( 4, 2 );
+	doc.AddChildParagraph();
+	// paraId is the id, duplicate one of copied paragraph get memory id
+	Element p0 = doc.GetElementAt( 0 );
+	Element p1 = doc.GetElementAt( 1 );
+	SPDDebug::SetParaId( p0, "0000ABCD" );
+	SPDDebug::SetParaId( p1, "0000ABCD" );
+
+	int err = 0;
+	std::vector<Element> eles;
+	std::vector<uint32_t> ids;
+	std::set<uint32_t> unique;
+	for( Element ele : doc.Children() ) {
+		eles.push_back( ele );
+		ids.push_back( doc.GetElementId( ele ) );
+		unique.insert( ids.back() );
+	}
+	if( ids[0] != 0xABCD || ids[1] < 0x80000000 || unique.size() != ids.size() || doc.GetElementId( Element() ) != 0 ) {
+		printf( "t_elemid: id of paraId or duplicate not match\n" );
+		++err;
+	}
+
+	// id is kept across insert and remove, removed id is not found
+	Paragraph( eles[5] ).AddSiblingParagraph();
+	Paragraph( eles[10] ).AddSiblingTable( false );
+	doc.DelChild( eles[7] );
+	doc.DelChild( eles[0] );
+	for( size_t i = 0; i < eles.size(); ++i ) {
+		Element found = doc.FindElementById( ids[i] );
+		if( ( i == 0 || i == 7 ) ? found.IsValid() : found != eles[i] ) {
+			printf( "t_elemid: id of element %d not match after edit\n", (int)i );
+			++err;
+		}
+	}
+	Element added = Paragraph( eles[5] ).GetNext();
+	uint32_t aid = doc.GetElementId( added );
+	if( unique.count( aid ) != 0 || doc.FindElementById( aid ) != added || doc.GetElementId( eles[1] ) != ids[1] ) {
+		printf( "t_elemid: id of new element not match\n" );
+		++err;
+	}
+
+	// Reset remove all old row and their id
+	std::vector<uint32_t> rowIds;
+	for( TRow row : tbl.Children<TRow>() )
+		rowIds.push_back( doc.GetElementId( row ) );
+	tbl.Reset( 2, 3 );
+	int rows = 0;
+	for( TRow row : tbl.Children<TRow>() ) {
+		++rows;
+		if( std::find( rowIds.begin(), rowIds.end(), doc.GetElementId( row ) ) != rowIds.end() )
+			++err;
+	}
+	for( uint32_t id : rowIds ) {
+		if( doc.FindElementById( id ).IsValid() )
+			++err;
+	}
+	if( rows != 2 || rowIds.size() != 4 || doc.FindElementById( ids[20] ) != tbl ) {
+		printf( "t_elemid: id after table Reset not match\n" );
+		++err;
+	}
+	if( SPDDebug::CheckIdIndex( doc ) != 0 ) {
+		printf( "t_elemid: id index not match rebuilt index\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_elemid: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_elemid: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_appender()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	// prototype row : span cell with run style, vmerge start cell, cell of two paragraph
+	Table tbl = doc.AddChildTable();
+	tbl.Fill( std::vector< std::vector<std::string> >{ { "a", "b", "c", "d" }, { "e", "f", "g", "h" } }, { "TCol0", "", "TCol2" } );
+	TRow proto = tbl.GetFirstChild();
+	TCell c0 = proto.GetFirstChild();
+	c0.SetSpanNum( 2 );
+	TCell c1 = c0.GetNext();
+	c1.SetVMergeNum( 2 );
+	TCell c2 = c1.GetNext();
+	c2.AddChildParagraph().AddChildRun().SetText( "d2" );
+	Paragraph p0 = *c0.Children<Paragraph>().begin();
+	Run r0 = *p0.Children<Run>().begin();
+	SPDDebug::SetRunStyle( r0, "Strong" );
+	SPDDebug::SetParaId( proto, "0000AAAA" );
+	SPDDebug::SetParaId( p0, "0000BBBB" );
+
+	int err = 0;
+	TRowAppender app;
+	if( app.Init( tbl, proto ) != SPD_ERR_OK || app.GetCellNum() != 3 ) {
+		printf( "t_appender: init not match, %d cells\n", app.GetCellNum() );
+		return -1;
+	}
+	// more value than cell is ignored, less value leave cell empty
+	TRow row = app.Append( { "x", " y ", "z", "extra" } );
+	TRow row2 = app.Append( { "only" } );
+	std::vector<std::string> texts;
+	for( TCell cell : row.Children<TCell>() )
+		texts.push_back( cell.GetText() );
+	for( TCell cell : row2.Children<TCell>() )
+		texts.push_back( cell.GetText() );
+	if( texts != std::vector<std::string>{ "x", " y ", "z", "only", "", "" } || tbl.GetLastChild() != row2 ) {
+		printf( "t_appender: appended cell text not match\n" );
+		++err;
+	}
+
+	// property of row / cell / paragraph / run is kept, id and vmerge is removed
+	std::string xml = SPDDebug::ElementXml( row );
+	TCell a0 = row.GetFirstChild();
+	if( a0.GetSpanNum() != 2 || TCell( a0.GetNext() ).GetVMergeType() != VMergeTypeE::NONE
+			|| xml.find( "<w:trPr" ) == std::string::npos || xml.find( "<w:gridSpan w:val=\"2\"/>" ) == std::string::npos
+			|| xml.find( "<w:pStyle w:val=\"TCol0\"/>" ) == std::string::npos || xml.find( "<w:pStyle w:val=\"TCol2\"/>" ) == std::string::npos
+			|| xml.find( "<w:rStyle w:val=\"Strong\"/>" ) == std::string::npos || xml.find( "xml:space=\"preserve\"" ) == std::string::npos ) {
+		printf( "t_appender: prototype property not kept\n" );
+		++err;
+	}
+	if( xml.find( "w14:paraId" ) != std::string::npos || xml.find( "w:vMerge" ) != std::string::npos
+			|| xml.find( "extra" ) != std::string::npos || xml.find( "d2" ) != std::string::npos ) {
+		printf( "t_appender: id, vmerge or extra content not removed\n" );
+		++err;
+	}
+	// prototype itself is untouched
+	if( c1.GetVMergeType() != VMergeTypeE::START || SPDDebug::ElementXml( proto ).find( "w14:paraId" ) == std::string::npos ) {
+		printf( "t_appender: prototype row changed\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_appender: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_appender: VERIFY OK!\n" );
+	return 0;
+}
+
+static int t_fill()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	// ragged row is padded to widest row, style of missing column is empty
+	std::vector< std::vector<std::string> > cells{ { "h0", "h1", "h2" }, { "a" }, { " b ", "c" } };
+	Table tbl = doc.AddChildTable();
+	int err = 0;
+	if( tbl.Fill( cells, { "TCol0", "", "TCol2", "TCol3" } ) != SPD_ERR_OK || tbl.GetRowNum() != 3 || tbl.GetColNum() != 3 ) {
+		printf( "t_fill: fill ragged rows FAILED!\n" );
+		return -1;
+	}
+	const std::vector<std::string> expect_style{ "TCol0", "", "TCol2" };
+	int i = 0;
+	for( TRow row : tbl.Children<TRow>() ) {
+		int j = 0;
+		for( TCell cell : row.Children<TCell>() ) {
+			const std::string & text = j < (int)cells[i].size() ? cells[i][j] : std::string();
+			Paragraph par = *cell.Children<Paragraph>().begin();
+			if( cell.GetText() != text || expect_style[j] != par.GetStyleId() ) {
+				printf( "t_fill: cell %d %d text or style not match\n", i, j );
+				++err;
+			}
+			// padded or empty cell has paragraph only, no run
+			if( text.empty() != par.Children<Run>().empty() ) {
+				printf( "t_fill: cell %d %d run not match\n", i, j );
+				++err;
+			}
+			++j;
+		}
+		if( j != 3 ) {
+			printf( "t_fill: row %d has %d cells\n", i, j );
+			++err;
+		}
+		++i;
+	}
+
+	// leading / trailing space is preserved, other text keep default
+	std::string xml = SPDDebug::ElementXml( tbl );
+	size_t pos = xml.find( "xml:space=\"preserve\"" );
+	if( pos == std::string::npos || xml.find( "xml:space", pos + 1 ) != std::string::npos
+			|| xml.find( "<w:t xml:space=\"preserve\"> b </w:t>" ) == std::string::npos ) {
+		printf( "t_fill: xml:space not match\n" );
+		++err;
+	}
+
+	// string_view overload build the same table
+	std::vector< std::vector<std::string_view> > views;
+	for( const auto & row : cells )
+		views.emplace_back( row.begin(), row.end() );
+	Table tbl2 = doc.AddChildTable();
+	if( tbl2.Fill( views, { "TCol0", "", "TCol2", "TCol3" } ) != SPD_ERR_OK || SPDDebug::ElementXml( tbl2 ) != xml ) {
+		printf( "t_fill: string_view overload not match\n" );
+		++err;
+	}
+	if( doc.AddChildTable().Fill( std::vector< std::vector<std::string> >{ {} } ) != SPD_ERR_BAD_PARAM ) {
+		printf( "t_fill: empty cells not rejected\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_fill: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_fill: VERIFY OK!\n" );
+	return 0;
+}
+
+// columns of one table match TableGrid and TCell::GetText, nested table text is not in cell
+static int check_extract( const Document & doc, const Table & tbl, const TableColumns & tc, int no )
+{
+	const TableGrid * grid = doc.GetTableGrid( tbl );
+	if( grid == nullptr || tc.m_rowNum != grid->GetRowNum() || tc.m_colNum != grid->GetColNum() || (int)tc.m_cols.size() < tc.m_colNum ) {
+		printf( "t_extract: table %d size %d x %d not match grid\n", no, tc.m_rowNum, tc.m_colNum );
+		return 1;
+	}
+	int err = 0;
+	for( int c = 0; c < tc.m_colNum; ++c ) {
+		const ColumnData & cd = tc.m_cols[c];
+		if( (int)cd.m_offset.size() != tc.m_rowNum + 1 || (int)cd.m_covered.size() != tc.m_rowNum
+				|| cd.m_offset.front() != 0 || cd.m_offset.back() != cd.m_data.size() || !std::is_sorted( cd.m_offset.begin(), cd.m_offset.end() ) ) {
+			printf( "t_extract: table %d col %d offset not match\n", no, c );
+			++err;
+			continue;
+		}
+		for( int r = 0; r < tc.m_rowNum; ++r ) {
+			const TableGrid::CellInfo * info = grid->GetOwner( r, c );
+			bool covered = info != nullptr && ( info->m_row != r || info->m_col != c );
+			std::string text = ( info != nullptr && !covered ) ? info->m_cell.GetText() : std::string();
+			if( cd.Get( r ) != text || cd.m_covered[r] != ( covered ? 1 : 0 ) ) {
+				printf( "t_extract: table %d cell %d %d not match\n", no, r, c );
+				++err;
+			}
+		}
+	}
+	std::vector<MergeRange> merges;
+	for( const TableGrid::CellInfo & info : grid->GetAllCell() ) {
+		if( info.m_rowSpan > 1 || info.m_colSpan > 1 )
+			merges.push_back( MergeRange{ info.m_row, info.m_col, info.m_rowSpan, info.m_colSpan } );
+	}
+	bool same = merges.size() == tc.m_merges.size();
+	for( size_t i = 0; same && i < merges.size(); ++i ) {
+		const MergeRange & a = merges[i];
+		const MergeRange & b = tc.m_merges[i];
+		same = a.m_row == b.m_row && a.m_col == b.m_col && a.m_rowSpan == b.m_rowSpan && a.m_colSpan == b.m_colSpan;
+	}
+	if( !same ) {
+		printf( "t_extract: table %d merges not match grid\n", no );
+		++err;
+	}
+	return err;
+}
+
+static int t_extract()
+{
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	doc.AddChildParagraph().AddChildRun().SetText( "p" );
+	// 3x4 table, row0 col1~col2 span, col3 vmerge row0~row1, col0 vmerge row1~row2
+	Table tbl = doc.AddChildTable();
+	tbl.Fill( std::vector< std::vector<std::string> >{ { "a0", "a1", "a2", "a3" }, { "b0", "b1", "b2", "b3" }, { "c0", "c1", "c2", "c3" } } );
+	TRow row0 = tbl.GetFirstChild();
+	TRow row1 = row0.GetNext();
+	TRow row2 = row1.GetNext();
+	row0.GetCell( 1 ).SetSpanNum( 2 );
+	row0.GetCell( 3 ).SetVMergeNum( 2 );
+	row1.GetCell( 0 ).SetVMergeNum( 2 );
+	// nested table in cell ( 2, 1 ), and nested again in its first cell, then a top level table
+	Table inner = row2.GetCell( 1 ).AddChildTable();
+	inner.Fill( std::vector< std::vector<std::string> >{ { "n0", "n1" }, { "n2", "n3" } } );
+	TRow irow0 = inner.GetFirstChild();
+	irow0.GetCell( 0 ).AddChildTable().Fill( std::vector< std::vector<std::string> >{ { "m0" } } );
+	irow0.GetCell( 0 ).SetVMergeNum( 2 );
+	doc.AddChildTable().Fill( std::vector< std::vector<std::string> >{ { "t0", "t1" } } );
+
+	int err = 0;
+	std::vector<TableColumns> tables( 6 );  // more buffer than table is trimmed
+	std::vector<Table> walk;
+	if( doc.ExtractTables( tables ) != 4 || tables.size() != 4 || doc.Query( "//w:tbl", walk ) != 4 ) {
+		printf( "t_extract: ExtractTables FAILED, %d tables!\n", (int)tables.size() );
+		return -1;
+	}
+	const int parent[] = { -1, 0, 1, -1 };
+	for( int i = 0; i < 4; ++i ) {
+		if( tables[i].m_parent != parent[i] ) {
+			printf( "t_extract: table %d parent %d not match\n", i, tables[i].m_parent );
+			++err;
+		}
+		err += check_extract( doc, walk[i], tables[i], i );
+	}
+	// fixed value of merged table, nested table text is not in outer cell
+	const TableColumns & tc = tables[0];
+	if( tc.m_cols[1].Get( 0 ) != "a1" || tc.m_cols[2].m_covered[0] != 1 || tc.m_cols[3].m_covered[1] != 1 || tc.m_cols[0].m_covered[2] != 1
+			|| tc.m_cols[1].Get( 2 ) != "c1" || tc.m_merges.size() != 3 || tables[1].m_cols[0].Get( 0 ) != "n0" ) {
+		printf( "t_extract: merged table value not match\n" );
+		++err;
+	}
+
+	if( err > 0 ) {
+		printf( "t_extract: VERIFY FAILED with %d error(s)!\n", err );
+		return -1;
+	}
+	printf( "t_extract: VERIFY OK!\n" );
+	return 0;
+}
+
+static int nav_count( Element ele )
+{
+	int num = 0;
+	for( ; ele.IsValid(); ele = ele.GetNext() ) {
+		num += 1 + nav_count( ele.GetFirstChild() );
+	}
+	return num;
+}
+
+static int b_nav( int num )
+{
+	// build a large document, paragraph with runs, and a small table every 50 paragraph
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	for( int i = 0; i < num; ++i ) {
+		Paragraph para = doc.AddChildParagraph();
+		for( int j = 0; j < 4; ++j ) {
+			Run r = para.AddChildRun();
+			r.SetBold( j == 1 );
+			r.SetText( "some text for navigation benchmark" );
+		}
+		if( i % 50 == 49 ) {
+			Table tbl = doc.AddChildTable();
+			tbl.Reset( 5, 4 );
+			for( TRow row = tbl.GetFirstChild(); row.IsValid(); row = row.GetNext() ) {
+				for( TCell cell = row.GetFirstChild(); cell.IsValid(); cell = cell.GetNext() ) {
+					cell.AddChildParagraph().AddChildRun().SetText( "cell" );
+				}
+			}
+		}
+	}
+
+	// full traversal through Element api
+	const int loop = 10;
+	int count = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	for( int i = 0; i < loop; ++i ) {
+		count = nav_count( doc.GetFirstElement() );
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>( t1 - t0 ).count() / loop;
+	printf( "b_nav: %d paragraphs, traverse %d elements, %.2f ms per pass, %.1f ns per element\n",
+		num, count, ms, count > 0 ? ms * 1e6 / count : 0.0 );
+
+	// classification compare with old strcmp chain
+	return SPDDebug::BenchNavClassify( doc );
+}
+
+static int b_handle( int num )
+{
+	// paragraph with runs only, node num is about num * 5
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	for( int i = 0; i < num; ++i ) {
+		Paragraph para = doc.AddChildParagraph();
+		for( int j = 0; j < 4; ++j ) {
+			para.AddChildRun().SetText( "handle" );
+		}
+	}
+
+	// iterate and create typed handle
+	const int loop = 5;
+	int count = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	for( int i = 0; i < loop; ++i ) {
+		count = 0;
+		for( Paragraph para : doc.Children<Paragraph>() ) {
+			for( Run r : para.Children<Run>() ) {
+				count += r.IsValid() ? 1 : 0;
+			}
+			count += 1;
+		}
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	double ns_iter = std::chrono::duration<double, std::nano>( t1 - t0 ).count() / loop / ( count > 0 ? count : 1 );
+
+	// create handle from Element and copy handle array, should be plain memory copy
+	std::vector<Element> eles;
+	eles.reserve( count );
+	for( Paragraph para : doc.Children<Paragraph>() ) {
+		eles.push_back( para );
+		for( Run r : para.Children<Run>() )
+			eles.push_back( r );
+	}
+	size_t valid = 0;
+	t0 = std::chrono::steady_clock::now();
+	for( int i = 0; i < loop; ++i ) {
+		std::vector<Run> runs;
+		runs.reserve( eles.size() );
+		for( const Element & ele : eles )
+			runs.push_back( Run( ele ) );
+		std::vector<Run> copy( runs );
+		valid += copy.size();
+	}
+	t1 = std::chrono::steady_clock::now();
+	double ns_copy = std::chrono::duration<double, std::nano>( t1 - t0 ).count() / loop / ( eles.empty() ? 1 : eles.size() );
+
+	printf( "b_handle: sizeof Element %d Run %d, %d handles, iterate %.1f ns per handle, create + copy %.1f ns per handle (%d)\n",
+		(int)sizeof(Element), (int)sizeof(Run), count, ns_iter, ns_copy, (int)( valid / loop ) );
+	return 0;
+}
+
+static int b_notify( int num )
+{
+	// every setter notify the owner Document, found by xml root among all open Document
+	Document others[8];
+	for( Document & other : others )
+		other.New();
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	std::vector<Run> runs;
+	runs.reserve( num );
+	for( int i = 0; i < num; ++i )
+		runs.push_back( doc.AddChildParagraph().AddChildRun() );
+
+	const int loop = 5;
+	auto t0 = std::chrono::steady_clock::now();
+	for( int i = 0; i < loop; ++i ) {
+		for( Run & r : runs )
+			r.SetBold( ( i & 1 ) == 0 );
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>( t1 - t0 ).count() / loop / ( num > 0 ? num : 1 );
+	printf( "b_notify: %d runs, %d documents open, SetBold %.1f ns per call\n", num, (int)( sizeof( others ) / sizeof( others[0] ) ) + 1, ns );
+	return 0;
+}
+
+static int b_fill( int rows )
+{
+	const int cols = 8;
+	std::vector< std::vector<std::string> > cells( rows, std::vector<std::string>( cols ) );
+	for( int i = 0; i < rows; ++i ) {
+		for( int j = 0; j < cols; ++j )
+			cells[i][j] = "R" + std::to_string( i ) + "C" + std::to_string( j );
+	}
+	std::vector<std::string> style( cols );
+	style[0] = "a3";
+
+	Document doc;
+	doc.New();
+	doc.DelAllChild();
+	Table tbl = doc.AddChildTable();
+
+	// bulk fill
+	auto t0 = std::chrono::steady_clock::now();
+	int ret = tbl.Fill( cells, style );
+	auto t1 = std::chrono::steady_clock::now();
+	double ms_fill = std::chrono::duration<double, std::milli>( t1 - t0 ).count();
+
+	// per cell api
+	Table tbl2 = doc.AddChildTable();
+	t0 = std::chrono::steady_clock::now();
+	tbl2.Reset( rows, cols );
+	int i = 0;
+	for( TRow row = tbl2.GetFirstChild(); row.IsValid(); row = row.GetNext(), ++i ) {
+		int j = 0;
+		for( TCell cell = row.GetFirstChild(); cell.IsValid(); cell = cell.GetNext(), ++j ) {
+			Paragraph para = cell.AddChildParagraph();
+			if( !style[j].empty() )
+				para.SetStyleId( style[j].c_str() );
+			para.AddChildRun().SetText( cells[i][j].c_str() );
+		}
+	}
+	t1 = std::chrono::steady_clock::now();
+	double ms_cell = std::chrono::duration<double, std::milli>( t1 - t0 ).count();
+
+	// clone prototype row, first row of bulk filled table
+	Table tbl3 = doc.AddChildTable();
+	tbl3.Reset( 1, cols );
+	TRowAppender app;
+	app.Init( tbl3, tbl.GetFirstChild() );
+	std::vector<std::string_view> values( cols );
+	t0 = std::chrono::steady_clock::now();
+	for( i = 0; i < rows; ++i ) {
+		for( int j = 0; j < cols; ++j )
+			values[j] = cells[i][j];
+		app.Append( values );
+	}
+	t1 = std::chrono::steady_clock::now();
+	double ms_app = std::chrono::duration<double, std::milli>( t1 - t0 ).count();
+
+	double num = (double)rows * cols;
+	printf( "b_fill: %d x %d cells ret %d, Fill %.2f ms ( %.2f M cells/s ), per cell api %.2f ms ( %.2f M cells/s ), row appender %.2f ms ( %.2f M cells/s )\n",
+		rows, cols, ret, ms_fill, ms_fill > 0 ? num / ms_fill / 1000 : 0.0, ms_cell, ms_cell > 0 ? num / ms_cell / 1000 : 0.0,
+		ms_app, ms_app > 0 ? num / ms_app / 1000 : 0.0 );
+	return 0;
+}
+
+static int conv( const char * fname )
+{
+	// read file to char string
+	std::ifstream ifs( fname, std::ios::binary );
+	if( !ifs.is_open() ) {
+		printf( "can't open file %s\n", fname );
+		return -1;
+	}
+	ifs.seekg( 0, std::ios::end );
+	long len = ifs.tellg();
+	ifs.seekg( 0, std::ios::beg );
+	char * buf = new char[len + 1];
+	ifs.read( buf, len );
+	buf[len] = '\0';
+	ifs.close();
+
+	printf( "const char * const str = \n\"" );
+	long i;
+	for( i = 0; i < len; ++i )
+	{
+		uint8_t ch = (uint8_t)buf[i];
+		if( ch == '"' ) {
+			printf( "\\\"" );
+		}
+		else if( ch == '\r' ) {
+			printf( "\\r" );
+		}
+		else if( ch == '\n' ) {
+			printf( "\\n" );
+		}
+		else if( ch >= 32 && ch <= 126 ) {
+			printf( "%c", ch );
+		}
+		else {
+			printf( "\\x%02x", ch );
+		}
+		if( i % 120 == 119 )
+		{
+			printf( "\"\n\"" );
+		}
+	}
+	printf( "\";\n" );
+
+	delete [] buf, buf = nullptr;
+	return 0;
+}
+
+static int usage()
+{
+	printf( "%s", R"(Usage: spdocxutil <cmd> <params>
+  usage | help        : show this usage
+  dumpinfo            : dump docx info
+  dumpdirjson         : dump docx dir in json
+  dumptables [-v] <file> ... : extract all tables of files in column layout, -v dump cell text
+  dumptext <file> [threads] : extract plain text of docx to stdout, threads 0 means all core
+  index build <dir> <file> ... : build full text index of files in dir
+  index add <dir> <file> ...   : add files not indexed yet as new segment
+  index query <dir> <text>     : find text ( token at consecutive position ) in index
+  newdoc              : create new docx 
+  conv                : conv file to char string
+  t_table             : test table create/merge/verify
+  t_table_2           : test table merge modification (remove/increase/add)
+  t_grid              : test table grid match cell api
+  t_cols              : test table multi column add/del
+  t_csv               : test table csv/tsv export and import
+  t_rows              : test table range row delete
+  t_repair            : test table validate and repair
+  t_text              : test plain text extract serial and parallel
+  t_replace           : test multi pattern replace across run
+  t_find              : test document text find
+  t_style             : test style name index
+  t_format            : test effective format of style chain
+  t_index             : test full text index commit, reopen and query
+  t_save              : test save copy, splice of untouched element and fallback
+  t_elem              : test top level element index after middle insert / remove
+  t_query             : test xpath query and compiled query cache
+  t_elemid            : test stable element id across insert / remove and table reset
+  t_appender          : test row appender keep prototype property and fill cell text
+  t_fill              : test bulk table fill of ragged rows, column style and space
+  t_extract           : test column extract of merged and nested table against grid
+  b_nav [num]         : benchmark element navigation on large document
+  b_handle [num]      : benchmark element handle iterate and copy
+  b_fill [rows]       : benchmark table bulk fill and row append
+  b_notify [num]      : benchmark setter change notify
+)" );
+	return 0;
+}
+
+int main( int argc, char * argv[] )
+{
+	if( argc < 2 ) {
+		usage();
+		return -1;
+	}
+
+	spd::SPD_SetLogLevel( SPD_LOG_LEVEL_DEBUG );
+	SPD_PR_INFO( "hello %d", 5 );
+
+	if( strcmp( argv[1], "dumpinfo" ) == 0 && argc >= 3 ) {
+		dumpinfo( argv[2] );
+		//char utf8_string[] = "\xE4\xB8\xAD\xE6\x96\x87.docx"; // 中文.docx
+		//dumpinfo( utf8_string );
+	}
+	else if( strcmp( argv[1], "dumptables" ) == 0 && argc >= 3 ) {
+		dumptables( argc - 2, argv + 2 );
+	}
+	else if( strcmp( argv[1], "dumptext" ) == 0 && argc >= 3 ) {
+		dumptext( argv[2], argc >= 4 ? atoi( argv[3] ) : 0 );
+	}
+	else if( strcmp( argv[1], "index" ) == 0 && argc >= 5 ) {
+		indexcmd( argc - 2, argv + 2 );
+	}
+	else if( strcmp( argv[1], "dumpdirjson" ) == 0 && argc >= 3 ) {
+		dumpdirjson( argv[2] );
+	}
+	else if( strcmp( argv[1], "newdoc" ) == 0 && argc >= 3 ) {
+		newdoc( argv[2] );
+	}
+	else if( strcmp( argv[1], "conv" ) == 0 && argc >= 3 ) {
+		conv( argv[2] );
+	}
+	else if( strcmp( argv[1], "t_table" ) == 0 ) {
+		t_table();
+	}
+	else if( strcmp( argv[1], "t_table_2" ) == 0 ) {
+		t_table_2();
+	}
+	else if( strcmp( argv[1], "t_rows" ) == 0 ) {
+		t_rows();
+	}
+	else if( strcmp( argv[1], "t_repair" ) == 0 ) {
+		t_repair();
+	}
+	else if( strcmp( argv[1], "t_text" ) == 0 ) {
+		t_text();
+	}
+	else if( strcmp( argv[1], "t_replace" ) == 0 ) {
+		t_replace();
+	}
+	else if( strcmp( argv[1], "t_find" ) == 0 ) {
+		t_find();
+	}
+	else if( strcmp( argv[1], "t_style" ) == 0 ) {
+		t_style();
+	}
+	else if( strcmp( argv[1], "t_format" ) == 0 ) {
+		t_format();
+	}
+	else if( strcmp( argv[1], "t_index" ) == 0 ) {
+		t_index();
+	}
+	else if( strcmp( argv[1], "t_save" ) == 0 ) {
+		t_save();
+	}
+	else if( strcmp( argv[1], "t_elem" ) == 0 ) {
+		t_elem();
+	}
+	else if( strcmp( argv[1], "t_query" ) == 0 ) {
+		t_query();
+	}
+	else if( strcmp( argv[1], "t_elemid" ) == 0 ) {
+		t_elemid();
+	}
+	else if( strcmp( argv[1], "t_appender" ) == 0 ) {
+		t_appender();
+	}
+	else if( strcmp( argv[1], "t_fill" ) == 0 ) {
+		t_fill();
+	}
+	else if( strcmp( argv[1], "t_extract" ) == 0 ) {
+		t_extract();
+	}
+	else if( strcmp( argv[1], "t_csv" ) == 0 ) {
+		t_csv();
+	}
+	else if( strcmp( argv[1], "t_cols" ) == 0 ) {
+		t_cols();
+	}
+	else if( strcmp( argv[1], "t_grid" ) == 0 ) {
+		t_grid();
+	}
+	else if( strcmp( argv[1], "b_nav" ) == 0 ) {
+		b_nav( argc >= 3 ? atoi( argv[2] ) : 100000 );
+	}
+	else if( strcmp( argv[1], "b_fill" ) == 0 ) {
+		b_fill( argc >= 3 ? atoi( argv[2] ) : 100000 );
+	}
+	else if( strcmp( argv[1], "b_notify" ) == 0 ) {
+		b_notify( argc >= 3 ? atoi( argv[2] ) : 100000 );
+	}
+	else if( strcmp( argv[1], "b_handle" ) == 0 ) {
+		b_handle( argc >= 3 ? atoi( argv[2] ) : 500000 );
 	}
 	else {
 		printf( "[ERR] unknown cmd or bad params\n" );